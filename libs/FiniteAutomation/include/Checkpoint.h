@@ -0,0 +1,32 @@
+#pragma once
+
+#include "MachineTable.h"
+#include "SessionEngine.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary snapshot of state ids: a fixed header (magic, version, kind, table fingerprint, session and record
+// counts, sequence numbers) followed by one state id per session (Full) or (session, state) pairs (Incremental).
+// Restoring maps the file once and rejects checkpoints written for a different table. Files are written under a
+// temporary name and renamed over the target, so a failed write leaves the previous checkpoint intact
+enum class CheckpointKind : std::uint32_t
+{
+	Full,
+	Incremental,
+};
+
+// Full checkpoint of run or instance states, e.g. the states passed to MachineTable::StepInstances
+void WriteCheckpoint(const std::string& name, const MachineTable& table, std::span<const MachineTable::Id> states);
+[[nodiscard]] std::vector<MachineTable::Id> RestoreCheckpoint(const std::string& name, const MachineTable& table);
+
+// Incremental checkpoints hold only the sessions changed since the previous checkpoint; both kinds clear the
+// engine's change marks once written and advance its checkpoint sequence
+void WriteCheckpoint(const std::string& name, SessionEngine& engine, CheckpointKind kind);
+
+// Applies a full checkpoint, or an incremental one on top of the current states, adding sessions as needed.
+// An incremental checkpoint is rejected unless the engine is at the sequence it was written after, so one applied
+// twice, out of order or after a skipped checkpoint fails instead of mixing states
+void RestoreCheckpoint(const std::string& name, SessionEngine& engine);
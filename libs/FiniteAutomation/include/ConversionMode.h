@@ -0,0 +1,8 @@
+#pragma once
+
+enum class ConversionMode
+{
+	Full,
+	ReachableOnly,
+	Parallel,
+};
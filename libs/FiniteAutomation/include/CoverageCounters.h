@@ -0,0 +1,89 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Transition hit counters with one array per thread, so counting never shares cache lines between threads.
+// Every thread passes its own index to RunInto; Merge may run at any time and sums the arrays per table cell
+// (state * inputCount + input). With sampleInterval N only every N-th step of a thread is counted, as N hits,
+// so rarely taken transitions may be missed. The table must outlive the counters
+class CoverageCounters
+{
+public:
+	using Id = MachineTable::Id;
+
+	CoverageCounters(const MachineTable& table, size_t threadCount, std::uint32_t sampleInterval = 1);
+
+	[[nodiscard]] size_t GetThreadCount() const;
+	[[nodiscard]] std::uint32_t GetSampleInterval() const;
+
+	[[nodiscard]] std::vector<std::uint64_t> Merge() const;
+	// Must not run concurrently with RunInto
+	void Clear();
+
+	// Same contract as MachineTable::RunInto, counting taken transitions in the array of the given thread
+	template <typename OutputSink>
+	size_t RunInto(size_t thread, std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw);
+
+private:
+	static constexpr size_t CACHE_LINE = 64;
+	static constexpr size_t COUNTERS_PER_LINE = CACHE_LINE / sizeof(std::uint64_t);
+
+	struct alignas(CACHE_LINE) Sampler
+	{
+		std::uint32_t countdown = 1;
+	};
+
+	void CheckThread(size_t thread) const;
+
+	const MachineTable& m_table;
+	size_t m_cellCount;
+	// Counters of one thread, rounded up to whole lines plus one spare line, so that no line holds two threads'
+	// counters whatever the alignment of the buffer
+	size_t m_stride;
+	std::uint32_t m_sampleInterval;
+	std::vector<std::atomic<std::uint64_t>> m_counters;
+	std::vector<Sampler> m_samplers;
+};
+
+// ToDotString() of the machine with the hit count added to every transition label; transitions without hits are
+// drawn dashed. hits are indexed like the cells of a table built from the same machine
+[[nodiscard]] std::string ToCoverageDotString(const MealyMachine& machine, std::span<const std::uint64_t> hits);
+[[nodiscard]] std::string ToCoverageDotString(const MooreMachine& machine, std::span<const std::uint64_t> hits);
+
+template <typename OutputSink>
+size_t CoverageCounters::RunInto(size_t thread, std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy)
+{
+	CheckThread(thread);
+
+	const std::uint32_t interval = m_sampleInterval;
+	std::atomic<std::uint64_t>* counters = m_counters.data() + thread * m_stride;
+	// The countdown lives in a local during the run and goes back to the sampler on every exit
+	std::uint32_t countdown = m_samplers[thread].countdown;
+	const auto onStep = [&](Id, Id, size_t cell) {
+		if (cell != MachineTable::NO_CELL && --countdown == 0)
+		{
+			countdown = interval;
+			// Only this thread writes the counter, so a relaxed load and store is enough to keep Merge well defined
+			auto& counter = counters[cell];
+			counter.store(counter.load(std::memory_order_relaxed) + interval, std::memory_order_relaxed);
+		}
+	};
+	try
+	{
+		const size_t consumed = m_table.RunInto(inputs, state, sink, onStep, policy);
+		m_samplers[thread].countdown = countdown;
+		return consumed;
+	}
+	catch (...)
+	{
+		m_samplers[thread].countdown = countdown;
+		throw;
+	}
+}
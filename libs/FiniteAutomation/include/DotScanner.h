@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Line scanner for the DOT subset read by MealyMachine::FromDotFile, MooreMachine::FromDotFile and
+// StaticMachine: `node [label = "..."]` and `node -> node [label = "..."]`, where nodes are [A-Za-z0-9_]+,
+// whitespace may surround every token except inside "[label" and "\"]", and any other line is ignored
+
+struct DotLine
+{
+	enum class Kind
+	{
+		None,
+		State,
+		Transition,
+	};
+
+	// The views point into the scanned line
+	Kind kind = Kind::None;
+	std::string_view fromNode;
+	std::string_view toNode;
+	std::string_view label;
+};
+
+constexpr bool IsDotSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+constexpr bool IsDotWordChar(char ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+constexpr DotLine ScanDotLine(std::string_view line)
+{
+	size_t pos = 0;
+	const auto skipSpaces = [&] {
+		while (pos < line.size() && IsDotSpace(line[pos]))
+		{
+			++pos;
+		}
+	};
+	const auto readWord = [&] {
+		const size_t begin = pos;
+		while (pos < line.size() && IsDotWordChar(line[pos]))
+		{
+			++pos;
+		}
+		return line.substr(begin, pos - begin);
+	};
+	const auto expect = [&](std::string_view token) {
+		if (line.substr(pos, token.size()) != token)
+		{
+			return false;
+		}
+		pos += token.size();
+		return true;
+	};
+
+	DotLine result;
+	skipSpaces();
+	result.fromNode = readWord();
+	if (result.fromNode.empty())
+	{
+		return {};
+	}
+	skipSpaces();
+
+	auto kind = DotLine::Kind::State;
+	if (expect("->"))
+	{
+		skipSpaces();
+		result.toNode = readWord();
+		if (result.toNode.empty())
+		{
+			return {};
+		}
+		skipSpaces();
+		kind = DotLine::Kind::Transition;
+	}
+
+	if (!expect("[label"))
+	{
+		return {};
+	}
+	skipSpaces();
+	if (!expect("="))
+	{
+		return {};
+	}
+	skipSpaces();
+	if (!expect("\""))
+	{
+		return {};
+	}
+
+	const size_t labelEnd = line.find('"', pos);
+	if (labelEnd == std::string_view::npos)
+	{
+		return {};
+	}
+	result.label = line.substr(pos, labelEnd - pos);
+	pos = labelEnd + 1;
+
+	if (!expect("]"))
+	{
+		return {};
+	}
+	skipSpaces();
+	if (pos != line.size())
+	{
+		return {};
+	}
+
+	result.kind = kind;
+	return result;
+}
+
+// Splits "left/right" at the first '/'; both parts must be non-empty
+constexpr bool SplitDotLabel(std::string_view label, std::string_view& left, std::string_view& right)
+{
+	const size_t slash = label.find('/');
+	if (slash == 0 || slash == std::string_view::npos || slash + 1 == label.size())
+	{
+		return false;
+	}
+	left = label.substr(0, slash);
+	right = label.substr(slash + 1);
+	return true;
+}
+
+// Calls func(line, lineNumber) for every '\n'-separated line of text, numbering lines from 1
+template <typename Func>
+constexpr void ForEachDotLine(std::string_view text, Func&& func)
+{
+	size_t lineNumber = 1;
+	while (!text.empty())
+	{
+		const size_t end = text.find('\n');
+		func(text.substr(0, end), lineNumber++);
+		text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+	}
+}
+
+// "line L, column C" of token, which must be a view into line
+inline std::string DescribeDotPosition(std::string_view line, size_t lineNumber, std::string_view token)
+{
+	const auto column = static_cast<size_t>(token.data() - line.data()) + 1;
+	return "line " + std::to_string(lineNumber) + ", column " + std::to_string(column);
+}
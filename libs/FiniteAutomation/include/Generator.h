@@ -0,0 +1,158 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+// Lazily produced sequence; the coroutine frame is allocated once and values are handed out by reference
+template <typename T>
+class Generator : public std::ranges::view_base
+{
+public:
+	struct promise_type
+	{
+		const T* value = nullptr;
+		std::exception_ptr error;
+
+		Generator get_return_object()
+		{
+			return Generator(Handle::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_always yield_value(const T& yielded) noexcept
+		{
+			value = std::addressof(yielded);
+			return {};
+		}
+
+		void return_void() noexcept
+		{
+		}
+
+		void unhandled_exception()
+		{
+			error = std::current_exception();
+		}
+
+		template <typename U>
+		std::suspend_never await_transform(U&&) = delete;
+	};
+
+	using Handle = std::coroutine_handle<promise_type>;
+
+	class Iterator
+	{
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+
+		explicit Iterator(Handle handle)
+			: m_handle(handle)
+		{
+		}
+
+		const T& operator*() const
+		{
+			return *m_handle.promise().value;
+		}
+
+		Iterator& operator++()
+		{
+			Resume(m_handle);
+			return *this;
+		}
+
+		void operator++(int)
+		{
+			++*this;
+		}
+
+		friend bool operator==(const Iterator& it, std::default_sentinel_t)
+		{
+			return !it.m_handle || it.m_handle.done();
+		}
+
+	private:
+		Handle m_handle;
+	};
+
+	Generator() = default;
+
+	Generator(Generator&& other) noexcept
+		: m_handle(std::exchange(other.m_handle, {}))
+	{
+	}
+
+	Generator& operator=(Generator&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Destroy();
+			m_handle = std::exchange(other.m_handle, {});
+		}
+		return *this;
+	}
+
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+
+	~Generator()
+	{
+		Destroy();
+	}
+
+	Iterator begin()
+	{
+		if (m_handle)
+		{
+			Resume(m_handle);
+		}
+		return Iterator(m_handle);
+	}
+
+	std::default_sentinel_t end() const noexcept
+	{
+		return {};
+	}
+
+private:
+	explicit Generator(Handle handle)
+		: m_handle(handle)
+	{
+	}
+
+	static void Resume(Handle handle)
+	{
+		handle.resume();
+		if (auto error = std::exchange(handle.promise().error, {}))
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	void Destroy()
+	{
+		if (m_handle)
+		{
+			m_handle.destroy();
+		}
+	}
+
+	Handle m_handle;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runs several machines over one input stream. The cells of all tables live in one arena and inputs are ids of
+// the union alphabet, remapped to every machine through one contiguous row per symbol.
+// A machine without a transition for the symbol (or without the symbol at all) keeps its state and emits NO_ID
+class LockstepRunner
+{
+public:
+	using Id = MachineTable::Id;
+
+	struct RunResult
+	{
+		// Step-major: outputs[step * machineCount + machine], in the output ids of each machine's table
+		std::vector<Id> outputs;
+		std::vector<Id> finalStates;
+	};
+
+	explicit LockstepRunner(std::span<const MachineTable> tables);
+
+	[[nodiscard]] size_t GetMachineCount() const;
+	[[nodiscard]] size_t GetInputCount() const;
+	[[nodiscard]] std::string_view GetInputName(Id input) const;
+	[[nodiscard]] Id FindInput(std::string_view name) const;
+	[[nodiscard]] std::vector<Id> EncodeInputs(std::span<const std::string> inputs) const;
+	[[nodiscard]] std::string_view GetOutputName(size_t machine, Id output) const;
+	[[nodiscard]] std::vector<Id> GetStartStates() const;
+
+	[[nodiscard]] RunResult Run(std::span<const Id> inputs) const;
+
+	// Advances states (one per machine) over inputs; outputs must hold inputs.size() * machineCount ids
+	void Run(std::span<const Id> inputs, std::span<Id> states, std::span<Id> outputs) const;
+
+private:
+	struct Machine
+	{
+		size_t firstCell = 0;
+		size_t columnCount = 0;
+		size_t stateCount = 0;
+		Id startState = MachineTable::NO_ID;
+	};
+
+	std::vector<Machine> m_machines;
+	std::vector<MachineTable::Cell> m_cells;
+	std::vector<Id> m_columns;
+	std::vector<std::string> m_inputNames;
+	std::vector<std::vector<std::string>> m_outputNames;
+};
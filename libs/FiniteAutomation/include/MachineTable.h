@@ -0,0 +1,232 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class MealyMachine;
+class MooreMachine;
+
+enum class MachineKind
+{
+	Mealy,
+	Moore,
+};
+
+enum class UndefinedTransitionPolicy
+{
+	Throw,
+	Stop,
+	Stay,
+};
+
+// Every keeps all outputs; OnChange keeps an output only when it differs from the previous one;
+// RunLength collapses equal neighbours into one output with a repeat count
+enum class OutputMode
+{
+	Every,
+	OnChange,
+	RunLength,
+};
+
+class MachineTable
+{
+public:
+	using Id = std::uint32_t;
+	static constexpr Id NO_ID = std::numeric_limits<Id>::max();
+	static constexpr size_t NO_CELL = std::numeric_limits<size_t>::max();
+
+	struct Cell
+	{
+		Id next = NO_ID;
+		Id output = NO_ID;
+	};
+
+	// positions (OnChange) are indexes into the full output sequence; counts (RunLength) match outputs one to one
+	struct RunResult
+	{
+		std::vector<Id> outputs;
+		std::vector<size_t> positions;
+		std::vector<size_t> counts;
+		Id finalState = NO_ID;
+		size_t consumed = 0;
+	};
+
+	struct NamedRunResult
+	{
+		std::vector<std::string> outputs;
+		std::vector<size_t> positions;
+		std::vector<size_t> counts;
+		std::string finalState;
+		size_t consumed = 0;
+	};
+
+	MachineTable() = default;
+	explicit MachineTable(const MealyMachine& machine);
+	explicit MachineTable(const MooreMachine& machine);
+
+	// Loads a DOT file of the given kind straight into a table: names are interned from views into the mapped file
+	// and only the final name tables and cells are allocated. Equals the table of MealyMachine::FromDotFile or
+	// MooreMachine::FromDotFile and reports the same errors. The file is split at line boundaries into chunkCount
+	// pieces scanned in parallel and merged in file order; chunkCount = 0 picks one chunk per MB up to one per
+	// hardware thread
+	[[nodiscard]] static MachineTable FromDotFile(const std::string& name, MachineKind kind, size_t chunkCount = 1);
+
+	// Versioned binary image (.fab): a header with magic, version, counts and checksum, the cell array and state
+	// outputs as stored here, then the name tables as offsets into one block of name bytes. Loading maps the file,
+	// verifies the checksum, which covers the header too, and that every id is in range, and copies the sections
+	// without parsing
+	void SaveBinary(const std::string& name) const;
+	[[nodiscard]] static MachineTable LoadBinary(const std::string& name);
+
+	[[nodiscard]] MachineKind GetKind() const;
+	[[nodiscard]] size_t GetStateCount() const;
+	[[nodiscard]] size_t GetInputCount() const;
+	[[nodiscard]] size_t GetOutputCount() const;
+	[[nodiscard]] Id GetStartState() const;
+
+	[[nodiscard]] std::string_view GetStateName(Id state) const;
+	[[nodiscard]] std::string_view GetInputName(Id input) const;
+	[[nodiscard]] std::string_view GetOutputName(Id output) const;
+	[[nodiscard]] Id FindState(std::string_view name) const;
+	[[nodiscard]] Id FindInput(std::string_view name) const;
+	[[nodiscard]] Id FindOutput(std::string_view name) const;
+	[[nodiscard]] std::vector<Id> EncodeInputs(std::span<const std::string> inputs) const;
+
+	[[nodiscard]] std::span<const Cell> GetCells() const;
+	[[nodiscard]] Id GetStateOutput(Id state) const;
+
+	// Copy whose state newId is state order[newId] of this table; order must be a permutation of the state ids
+	[[nodiscard]] MachineTable WithStateOrder(std::span<const Id> order) const;
+
+	// FNV-1a hash of names, cells, state outputs and start state; equal for tables built from the same machine
+	[[nodiscard]] std::uint64_t GetFingerprint() const;
+
+	[[nodiscard]] Cell GetCell(Id state, Id input) const
+	{
+		return m_cells[static_cast<size_t>(state) * m_inputCount + input];
+	}
+
+	// A Moore table emits the output of every state entered; the start state output is not emitted, as in
+	// TransduceMoore, and is available from GetStateOutput(GetStartState())
+	[[nodiscard]] RunResult Run(std::span<const Id> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+	[[nodiscard]] RunResult Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+	[[nodiscard]] NamedRunResult Decode(const RunResult& result) const;
+
+	// Runs independent streams from the start state, interleaving their steps to overlap table lookups
+	[[nodiscard]] std::vector<RunResult> RunBatch(std::span<const std::span<const Id>> streams, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+
+	// Splits one long input into chunks, runs every chunk from all states it may start in, then replays the chunks
+	// in parallel from their resolved start states. chunkCount = 0 picks one chunk per hardware thread
+	[[nodiscard]] RunResult RunParallel(std::span<const Id> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, size_t chunkCount = 0) const;
+
+	// Steps states.size() instances in lockstep; inputs and outputs are step-major (step * instanceCount + instance).
+	// An undefined transition keeps the instance state and emits NO_ID
+	void StepInstances(std::span<Id> states, std::span<const Id> inputs, std::span<Id> outputs) const;
+
+	// Advances state over inputs, passing every emitted output to sink; returns the number of consumed inputs
+	template <typename OutputSink>
+	size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw) const;
+
+	// Same as RunInto, calling onStep(state, input, cellIndex) before every consumed step with the state it starts
+	// from. cellIndex is state * inputCount + input, or NO_CELL when Stay keeps the state on an undefined transition
+	template <typename OutputSink, typename StepObserver>
+		requires std::invocable<StepObserver&, Id, Id, size_t>
+	size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, StepObserver&& onStep, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw) const;
+
+private:
+	// Tells the optimizer that a computed cell index is never NO_CELL, so step observers can drop that check
+	static void AssumeCellIndex(size_t index)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		if (index == NO_CELL)
+		{
+			__builtin_unreachable();
+		}
+#elif defined(_MSC_VER)
+		__assume(index != NO_CELL);
+#else
+		(void)index;
+#endif
+	}
+
+	[[noreturn]] void ThrowUndefinedTransition(Id state, Id input) const;
+	void CheckState(Id state) const;
+	void BuildIndexes();
+
+	struct StringHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view value) const
+		{
+			return std::hash<std::string_view>{}(value);
+		}
+	};
+	using NameIndex = std::unordered_map<std::string, Id, StringHash, std::equal_to<>>;
+
+	MachineKind m_kind = MachineKind::Mealy;
+	size_t m_inputCount = 0;
+	Id m_startState = NO_ID;
+	std::vector<Cell> m_cells;
+	std::vector<Id> m_stateOutputs;
+	std::vector<std::string> m_stateNames;
+	std::vector<std::string> m_inputNames;
+	std::vector<std::string> m_outputNames;
+	NameIndex m_stateIds;
+	NameIndex m_inputIds;
+	NameIndex m_outputIds;
+};
+
+template <typename OutputSink>
+size_t MachineTable::RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy) const
+{
+	return RunInto(inputs, state, sink, [](Id, Id, size_t) {}, policy);
+}
+
+template <typename OutputSink, typename StepObserver>
+	requires std::invocable<StepObserver&, MachineTable::Id, MachineTable::Id, size_t>
+size_t MachineTable::RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, StepObserver&& onStep, UndefinedTransitionPolicy policy) const
+{
+	CheckState(state);
+
+	const Cell* cells = m_cells.data();
+	const size_t inputCount = m_inputCount;
+
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		const Id input = inputs[i];
+		if (input < inputCount)
+		{
+			const size_t index = static_cast<size_t>(state) * inputCount + input;
+			const Cell cell = cells[index];
+			if (cell.next != NO_ID)
+			{
+				AssumeCellIndex(index);
+				onStep(state, input, index);
+				state = cell.next;
+				sink(cell.output);
+				continue;
+			}
+		}
+
+		switch (policy)
+		{
+		case UndefinedTransitionPolicy::Throw:
+			ThrowUndefinedTransition(state, input);
+		case UndefinedTransitionPolicy::Stop:
+			return i;
+		case UndefinedTransitionPolicy::Stay:
+			onStep(state, input, NO_CELL);
+			break;
+		}
+	}
+
+	return inputs.size();
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "ConversionMode.h"
+#include "MachineTable.h"
+
 #include <map>
+#include <ostream>
 #include <set>
+#include <span>
 #include <string>
 
 class MooreMachine;
@@ -15,13 +20,22 @@ public:
 	MealyMachine() = default;
 	explicit MealyMachine(State initState);
 	explicit MealyMachine(const MooreMachine& mooreMachine);
+	MealyMachine(const MooreMachine& mooreMachine, ConversionMode mode);
 
 	static MealyMachine FromDotFile(const std::string& name);
 	std::string ToDotString() const;
+	// Writes the text of ToDotString() to output through a large buffer instead of building it in memory
+	void WriteDot(std::ostream& output) const;
+	[[nodiscard]] std::string ToCppSource(const std::string& name) const;
 	[[nodiscard]] std::string Print() const;
 
 	[[nodiscard]] MealyMachine Minimize() const;
 
+	// Serial composition: the outputs of first are the inputs of second. States are the reachable pairs, named
+	// "<first>_<second>"; a pair transition is undefined when either machine's transition is
+	[[nodiscard]] static MealyMachine Compose(const MealyMachine& first, const MealyMachine& second, bool minimize = false);
+	[[nodiscard]] MachineTable::NamedRunResult Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+
 	[[nodiscard]] std::set<State> GetStates() const;
 	[[nodiscard]] State GetStartState() const;
 	[[nodiscard]] MealyTransitions GetTransitions() const;
@@ -30,6 +44,9 @@ public:
 	void SetTransition(const State& fromState, const std::string& input, const State& toState, const std::string& output);
 
 private:
+	// Conversions read the other machine's containers directly instead of copying them
+	friend class MooreMachine;
+
 	std::set<State> m_states;
 	MealyTransitions m_transitions;
 	State m_startState;
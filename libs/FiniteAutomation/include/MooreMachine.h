@@ -1,7 +1,12 @@
 ﻿#pragma once
 
+#include "ConversionMode.h"
+#include "MachineTable.h"
+
 #include <map>
+#include <ostream>
 #include <set>
+#include <span>
 #include <string>
 
 class MealyMachine;
@@ -16,12 +21,17 @@ public:
 	MooreMachine() = default;
 	explicit MooreMachine(State initState);
 	explicit MooreMachine(const MealyMachine& mealyMachine);
+	MooreMachine(const MealyMachine& mealyMachine, ConversionMode mode);
 
 	static MooreMachine FromDotFile(const std::string& name);
 	std::string ToDotString() const;
+	// Writes the text of ToDotString() to output through a large buffer instead of building it in memory
+	void WriteDot(std::ostream& output) const;
+	[[nodiscard]] std::string ToCppSource(const std::string& name) const;
 	[[nodiscard]] std::string Print() const;
 
 	[[nodiscard]] MooreMachine Minimize() const;
+	[[nodiscard]] MachineTable::NamedRunResult Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
 
 	[[nodiscard]] std::set<State> GetStates() const;
 	[[nodiscard]] State GetStartState() const;
@@ -33,6 +43,9 @@ public:
 	void SetStateOutput(const State& state, const std::string& output);
 
 private:
+	// Conversions read the other machine's containers directly instead of copying them
+	friend class MealyMachine;
+
 	std::set<State> m_states;
 	MooreTransitions m_transitions;
 	MooreOutputs m_outputs;
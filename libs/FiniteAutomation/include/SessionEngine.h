@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+enum class SessionBatchOrder
+{
+	// Events run in arrival order with the session states and table rows of upcoming events prefetched
+	Arrival,
+	// Events run in rounds (the r-th event of every session), each round grouped by current state so that sessions
+	// in one state share a table row. Pays off only for tables far larger than the cache and many events per state
+	ByState,
+};
+
+// Many instances of one machine, stored as a dense array of state ids indexed by session id.
+// The table must outlive the engine
+class SessionEngine
+{
+public:
+	using Id = MachineTable::Id;
+	using SessionId = std::uint32_t;
+
+	struct Event
+	{
+		SessionId session = 0;
+		Id input = MachineTable::NO_ID;
+	};
+
+	explicit SessionEngine(const MachineTable& table, size_t sessionCount = 0);
+
+	SessionId AddSession();
+	void AddSessions(size_t count);
+	void ResetSession(SessionId session);
+
+	[[nodiscard]] size_t GetSessionCount() const;
+	[[nodiscard]] Id GetState(SessionId session) const;
+	void SetState(SessionId session, Id state);
+	[[nodiscard]] std::span<const Id> GetStates() const;
+	[[nodiscard]] const MachineTable& GetTable() const;
+
+	// Sessions added or moved to another state since the last ClearChanges, in ascending order
+	[[nodiscard]] std::vector<SessionId> GetChangedSessions() const;
+	void ClearChanges();
+
+	// Sequence number of the last checkpoint written from or restored into this engine, 0 before the first one.
+	// An incremental checkpoint applies only to an engine at the sequence it was written after
+	[[nodiscard]] std::uint64_t GetCheckpointSequence() const;
+	void SetCheckpointSequence(std::uint64_t sequence);
+
+	// Applies events in order per session; outputs[i] receives the output of events[i], or NO_ID when the
+	// transition is undefined and the session keeps its state
+	void Apply(std::span<const Event> events, std::span<Id> outputs, SessionBatchOrder order = SessionBatchOrder::Arrival);
+	[[nodiscard]] std::vector<Id> Apply(std::span<const Event> events, SessionBatchOrder order = SessionBatchOrder::Arrival);
+
+private:
+	struct PendingEvent
+	{
+		Id state;
+		SessionId session;
+		Id input;
+		std::uint32_t index;
+	};
+
+	void ApplyInArrivalOrder(std::span<const Event> events, std::span<Id> outputs);
+	void ApplyByState(std::span<const Event> events, std::span<Id> outputs);
+	void ApplyRound(std::span<const Event> events, std::span<const std::uint32_t> round, std::span<Id> outputs);
+	void CheckSession(SessionId session) const;
+	void MarkChanged(SessionId session, bool changed);
+
+	const MachineTable& m_table;
+	std::vector<Id> m_states;
+	std::vector<std::uint64_t> m_changed;
+	std::uint64_t m_checkpointSequence = 0;
+	std::vector<std::uint32_t> m_eventCounts;
+	std::vector<std::uint32_t> m_eventRounds;
+	std::vector<std::uint32_t> m_roundOrder;
+	std::vector<size_t> m_stateStarts;
+	std::vector<PendingEvent> m_pending;
+	std::vector<PendingEvent> m_bucketed;
+};
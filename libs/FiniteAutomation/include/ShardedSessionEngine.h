@@ -0,0 +1,66 @@
+#pragma once
+
+#include "SessionEngine.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Sessions spread over shards by session id (session % shardCount), each shard with its own event queue, state
+// array and output buffer. Workers process whichever shard has events, their own shards first, so idle workers
+// steal skewed load; a shard is processed by one worker at a time, which keeps per-session event order.
+// The table must outlive the engine
+class ShardedSessionEngine
+{
+public:
+	using Id = SessionEngine::Id;
+	using SessionId = SessionEngine::SessionId;
+	using Event = SessionEngine::Event;
+
+	struct Emission
+	{
+		SessionId session = 0;
+		Id output = MachineTable::NO_ID;
+	};
+
+	static constexpr size_t DEFAULT_QUEUE_CAPACITY = size_t{1} << 14;
+
+	// workerCount = 0 picks one worker per hardware thread, shardCount = 0 four shards per worker
+	ShardedSessionEngine(const MachineTable& table, size_t sessionCount, size_t workerCount = 0, size_t shardCount = 0, size_t queueCapacity = DEFAULT_QUEUE_CAPACITY);
+	~ShardedSessionEngine();
+
+	ShardedSessionEngine(const ShardedSessionEngine&) = delete;
+	ShardedSessionEngine& operator=(const ShardedSessionEngine&) = delete;
+
+	// Safe to call from any number of threads; blocks while the shard queue is full
+	void Submit(const Event& event);
+	void Submit(std::span<const Event> events);
+
+	// Blocks until every event submitted before the call has been applied
+	void Flush();
+
+	// Returns and clears the buffered outputs, shard by shard, in per-session event order.
+	// An undefined transition leaves the session state unchanged and emits NO_ID
+	[[nodiscard]] std::vector<Emission> TakeOutputs();
+
+	[[nodiscard]] Id GetState(SessionId session) const;
+	[[nodiscard]] size_t GetSessionCount() const;
+	[[nodiscard]] size_t GetShardCount() const;
+	[[nodiscard]] size_t GetWorkerCount() const;
+
+private:
+	struct Shard;
+
+	void RunWorker(const std::stop_token& stop, size_t worker);
+	bool ProcessShard(Shard& shard);
+	void CheckSession(SessionId session) const;
+
+	size_t m_sessionCount;
+	size_t m_workerCount;
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	std::atomic<size_t> m_pendingEvents = 0;
+	std::vector<std::jthread> m_workers;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+// Counts how often every transition of a table is taken; hits are indexed like the table cells
+// (state * inputCount + input). The table must outlive the profile
+class TransitionProfile
+{
+public:
+	using Id = MachineTable::Id;
+
+	explicit TransitionProfile(const MachineTable& table);
+
+	[[nodiscard]] std::span<const std::uint64_t> GetHits() const;
+	[[nodiscard]] std::uint64_t GetHits(Id state, Id input) const;
+
+	void Clear();
+	// Adds the counters of a profile collected on the same table
+	void Merge(const TransitionProfile& other);
+
+	void Record(Id state, Id input)
+	{
+		++m_hits[static_cast<size_t>(state) * m_inputCount + input];
+	}
+
+	// Same contract as MachineTable::RunInto, counting every taken transition
+	template <typename OutputSink>
+	size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw);
+
+private:
+	const MachineTable& m_table;
+	size_t m_inputCount;
+	std::vector<std::uint64_t> m_hits;
+};
+
+// Orders states so that hot transition chains get neighbouring ids: starting from the hottest unplaced state,
+// follows the most taken transition to an unplaced successor until the chain ends. States without hits keep
+// their relative order at the end. The result lists old ids by new id, as MachineTable::WithStateOrder expects
+[[nodiscard]] std::vector<MachineTable::Id> ComputeHotStateOrder(const MachineTable& table, std::span<const std::uint64_t> hits);
+
+// Writes one state name per line in the given order
+void WriteStateOrder(const MachineTable& table, std::span<const MachineTable::Id> order, std::ostream& output);
+
+// Reads a saved order by state names. Unknown and repeated names are skipped and states missing from the file
+// are appended in their current order, so an order saved for an older version of the machine stays usable
+[[nodiscard]] std::vector<MachineTable::Id> ReadStateOrder(const MachineTable& table, std::istream& input);
+
+template <typename OutputSink>
+size_t TransitionProfile::RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy)
+{
+	std::uint64_t* hits = m_hits.data();
+	return m_table.RunInto(inputs, state, sink, [hits](Id, Id, size_t cell) {
+		if (cell != MachineTable::NO_CELL)
+		{
+			++hits[cell];
+		}
+	}, policy);
+}
@@ -0,0 +1,501 @@
+#pragma once
+
+#include "DotScanner.h"
+#include "MachineTable.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+struct StaticMealyTransition
+{
+	std::string_view fromState;
+	std::string_view input;
+	std::string_view toState;
+	std::string_view output;
+};
+
+struct StaticMooreState
+{
+	std::string_view state;
+	std::string_view output;
+};
+
+struct StaticMooreTransition
+{
+	std::string_view fromState;
+	std::string_view input;
+	std::string_view toState;
+};
+
+template <size_t MaxCount>
+using StaticMachineId = std::conditional_t<(MaxCount < UINT8_MAX), std::uint8_t, std::conditional_t<(MaxCount < UINT16_MAX), std::uint16_t, std::uint32_t>>;
+
+class StaticMachineBuilder;
+
+// Machine whose tables are sized by template arguments, so a constexpr instance lives entirely in read-only data.
+// States, inputs and outputs are numbered in sorted name order, as in MachineTable
+template <MachineKind Kind, size_t StateCount, size_t InputCount, size_t OutputCount>
+class StaticMachine
+{
+public:
+	using Id = StaticMachineId<std::max({StateCount, InputCount, OutputCount})>;
+	static constexpr Id NO_ID = std::numeric_limits<Id>::max();
+
+	struct Cell
+	{
+		Id next = NO_ID;
+		Id output = NO_ID;
+	};
+
+	[[nodiscard]] static constexpr MachineKind GetKind()
+	{
+		return Kind;
+	}
+
+	[[nodiscard]] static constexpr size_t GetStateCount()
+	{
+		return StateCount;
+	}
+
+	[[nodiscard]] static constexpr size_t GetInputCount()
+	{
+		return InputCount;
+	}
+
+	[[nodiscard]] static constexpr size_t GetOutputCount()
+	{
+		return OutputCount;
+	}
+
+	[[nodiscard]] constexpr Id GetStartState() const
+	{
+		return m_startState;
+	}
+
+	[[nodiscard]] constexpr std::string_view GetStateName(Id state) const
+	{
+		return GetName(m_stateNames, state);
+	}
+
+	[[nodiscard]] constexpr std::string_view GetInputName(Id input) const
+	{
+		return GetName(m_inputNames, input);
+	}
+
+	[[nodiscard]] constexpr std::string_view GetOutputName(Id output) const
+	{
+		return GetName(m_outputNames, output);
+	}
+
+	[[nodiscard]] constexpr Id FindState(std::string_view name) const
+	{
+		return Find(m_stateNames, name);
+	}
+
+	[[nodiscard]] constexpr Id FindInput(std::string_view name) const
+	{
+		return Find(m_inputNames, name);
+	}
+
+	[[nodiscard]] constexpr Id FindOutput(std::string_view name) const
+	{
+		return Find(m_outputNames, name);
+	}
+
+	[[nodiscard]] constexpr Id GetStateOutput(Id state) const
+		requires(Kind == MachineKind::Moore)
+	{
+		return state < StateCount ? m_stateOutputs[state] : NO_ID;
+	}
+
+	[[nodiscard]] constexpr Cell GetCell(Id state, Id input) const
+	{
+		return m_cells[static_cast<size_t>(state) * InputCount + input];
+	}
+
+	// Returns false and leaves state unchanged when the transition is undefined
+	constexpr bool Step(Id& state, Id input, Id& output) const
+	{
+		if (state >= StateCount || input >= InputCount)
+		{
+			return false;
+		}
+
+		const Cell cell = GetCell(state, input);
+		if (cell.next == NO_ID)
+		{
+			return false;
+		}
+
+		state = cell.next;
+		output = cell.output;
+		return true;
+	}
+
+	// Same contract as MachineTable::RunInto
+	template <typename OutputSink>
+	constexpr size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw) const
+	{
+		if (state >= StateCount)
+		{
+			throw std::out_of_range("Unknown state id");
+		}
+
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			Id output = NO_ID;
+			if (Step(state, inputs[i], output))
+			{
+				sink(output);
+				continue;
+			}
+
+			switch (policy)
+			{
+			case UndefinedTransitionPolicy::Throw:
+				throw std::runtime_error("Undefined transition");
+			case UndefinedTransitionPolicy::Stop:
+				return i;
+			case UndefinedTransitionPolicy::Stay:
+				break;
+			}
+		}
+
+		return inputs.size();
+	}
+
+private:
+	friend class StaticMachineBuilder;
+
+	template <size_t Count>
+	static constexpr std::string_view GetName(const std::array<std::string_view, Count>& names, Id id)
+	{
+		if (id >= Count)
+		{
+			throw std::out_of_range("Unknown id");
+		}
+		return names[id];
+	}
+
+	template <size_t Count>
+	static constexpr Id Find(const std::array<std::string_view, Count>& names, std::string_view name)
+	{
+		const auto it = std::lower_bound(names.begin(), names.end(), name);
+		return it != names.end() && *it == name ? static_cast<Id>(it - names.begin()) : NO_ID;
+	}
+
+	Id m_startState = NO_ID;
+	std::array<Cell, StateCount * InputCount> m_cells{};
+	std::array<Id, Kind == MachineKind::Moore ? StateCount : 0> m_stateOutputs{};
+	std::array<std::string_view, StateCount> m_stateNames{};
+	std::array<std::string_view, InputCount> m_inputNames{};
+	std::array<std::string_view, OutputCount> m_outputNames{};
+};
+
+template <size_t StateCount, size_t InputCount, size_t OutputCount>
+using StaticMealyMachine = StaticMachine<MachineKind::Mealy, StateCount, InputCount, OutputCount>;
+
+template <size_t StateCount, size_t InputCount, size_t OutputCount>
+using StaticMooreMachine = StaticMachine<MachineKind::Moore, StateCount, InputCount, OutputCount>;
+
+// Turns a definition source into a StaticMachine in two passes: the first sizes the tables, the second fills them.
+// Later transitions and state declarations overwrite earlier ones, as MealyMachine::SetTransition and
+// MooreMachine::SetStateOutput do. Mealy transitions add their states; Moore transitions must use declared states
+class StaticMachineBuilder
+{
+public:
+	template <MachineKind Kind, typename Source>
+	static consteval auto Make()
+	{
+		constexpr auto definition = GetDefinition<Kind, Source>();
+		constexpr size_t stateCount = GatherStates<Kind>(definition).size;
+		constexpr size_t inputCount = GatherInputs(definition).size;
+		constexpr size_t outputCount = GatherOutputs<Kind>(definition).size;
+		return Build<Kind, stateCount, inputCount, outputCount>(definition);
+	}
+
+private:
+	template <size_t DeclaredStateCount, size_t TransitionCount>
+	struct Definition
+	{
+		std::array<StaticMooreState, DeclaredStateCount> states{};
+		std::array<StaticMealyTransition, TransitionCount> transitions{};
+	};
+
+	template <size_t Capacity>
+	struct NameList
+	{
+		std::array<std::string_view, Capacity> names{};
+		size_t size = 0;
+
+		constexpr void Add(std::string_view name)
+		{
+			names[size++] = name;
+		}
+
+		constexpr void SortUnique()
+		{
+			std::sort(names.begin(), names.begin() + static_cast<std::ptrdiff_t>(size));
+			size = static_cast<size_t>(std::unique(names.begin(), names.begin() + static_cast<std::ptrdiff_t>(size)) - names.begin());
+		}
+	};
+
+	struct DotCounts
+	{
+		size_t states = 0;
+		size_t transitions = 0;
+	};
+
+	template <MachineKind Kind, typename Source>
+	static consteval auto GetDefinition()
+	{
+		using Result = decltype(Source{}());
+		if constexpr (std::is_convertible_v<Result, std::string_view>)
+		{
+			constexpr std::string_view text = Source{}();
+			constexpr DotCounts counts = CountDotLines(text);
+			return ParseDot<Kind, counts.states, counts.transitions>(text);
+		}
+		else if constexpr (Kind == MachineKind::Mealy)
+		{
+			constexpr auto transitions = Source{}();
+			return Definition<0, transitions.size()>{{}, transitions};
+		}
+		else
+		{
+			constexpr auto source = Source{}();
+			Definition<source.first.size(), source.second.size()> definition{source.first, {}};
+			for (size_t i = 0; i < source.second.size(); ++i)
+			{
+				const auto& transition = source.second[i];
+				definition.transitions[i] = {transition.fromState, transition.input, transition.toState, {}};
+			}
+			return definition;
+		}
+	}
+
+	static constexpr DotCounts CountDotLines(std::string_view text)
+	{
+		DotCounts counts;
+		ForEachDotLine(text, [&](std::string_view line, size_t) {
+			const auto kind = ScanDotLine(line).kind;
+			counts.states += kind == DotLine::Kind::State ? 1 : 0;
+			counts.transitions += kind == DotLine::Kind::Transition ? 1 : 0;
+		});
+		return counts;
+	}
+
+	template <MachineKind Kind, size_t DeclaredStateCount, size_t TransitionCount>
+	static constexpr auto ParseDot(std::string_view text)
+	{
+		Definition<DeclaredStateCount, TransitionCount> definition;
+		std::array<std::string_view, DeclaredStateCount> nodes{};
+		size_t stateCount = 0;
+		size_t transitionCount = 0;
+
+		const auto findState = [&](std::string_view node) {
+			for (size_t i = stateCount; i > 0; --i)
+			{
+				if (nodes[i - 1] == node)
+				{
+					return definition.states[i - 1].state;
+				}
+			}
+			throw std::out_of_range("Transition refers to an undeclared node");
+		};
+
+		ForEachDotLine(text, [&](std::string_view line, size_t) {
+			const DotLine dotLine = ScanDotLine(line);
+			if (dotLine.kind == DotLine::Kind::State)
+			{
+				StaticMooreState state{dotLine.fromNode, {}};
+				if (Kind == MachineKind::Moore && !SplitDotLabel(dotLine.label, state.state, state.output))
+				{
+					state.state = dotLine.label;
+				}
+				nodes[stateCount] = dotLine.fromNode;
+				definition.states[stateCount++] = state;
+			}
+			else if (dotLine.kind == DotLine::Kind::Transition)
+			{
+				StaticMealyTransition transition{findState(dotLine.fromNode), dotLine.label, findState(dotLine.toNode), {}};
+				if (Kind == MachineKind::Mealy && !SplitDotLabel(dotLine.label, transition.input, transition.output))
+				{
+					throw std::runtime_error("Invalid transition label format");
+				}
+				definition.transitions[transitionCount++] = transition;
+			}
+		});
+
+		return definition;
+	}
+
+	template <size_t Count>
+	static constexpr bool IsOverwritten(const std::array<StaticMealyTransition, Count>& transitions, size_t index)
+	{
+		for (size_t i = index + 1; i < Count; ++i)
+		{
+			if (transitions[i].fromState == transitions[index].fromState && transitions[i].input == transitions[index].input)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <size_t Count>
+	static constexpr bool IsOverwritten(const std::array<StaticMooreState, Count>& states, size_t index)
+	{
+		for (size_t i = index + 1; i < Count; ++i)
+		{
+			if (states[i].state == states[index].state)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <MachineKind Kind, size_t S, size_t T>
+	static constexpr auto GatherStates(const Definition<S, T>& definition)
+	{
+		NameList<S + 2 * T> list;
+		for (const auto& state : definition.states)
+		{
+			list.Add(state.state);
+		}
+		if constexpr (Kind == MachineKind::Mealy)
+		{
+			for (const auto& transition : definition.transitions)
+			{
+				list.Add(transition.fromState);
+				list.Add(transition.toState);
+			}
+		}
+		list.SortUnique();
+		return list;
+	}
+
+	template <size_t S, size_t T>
+	static constexpr auto GatherInputs(const Definition<S, T>& definition)
+	{
+		NameList<T> list;
+		for (const auto& transition : definition.transitions)
+		{
+			list.Add(transition.input);
+		}
+		list.SortUnique();
+		return list;
+	}
+
+	template <MachineKind Kind, size_t S, size_t T>
+	static constexpr auto GatherOutputs(const Definition<S, T>& definition)
+	{
+		NameList<Kind == MachineKind::Mealy ? T : S> list;
+		if constexpr (Kind == MachineKind::Mealy)
+		{
+			for (size_t i = 0; i < T; ++i)
+			{
+				if (!IsOverwritten(definition.transitions, i))
+				{
+					list.Add(definition.transitions[i].output);
+				}
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < S; ++i)
+			{
+				if (!IsOverwritten(definition.states, i))
+				{
+					list.Add(definition.states[i].output);
+				}
+			}
+		}
+		list.SortUnique();
+		return list;
+	}
+
+	template <size_t Count, size_t Capacity>
+	static constexpr std::array<std::string_view, Count> ToArray(const NameList<Capacity>& list)
+	{
+		std::array<std::string_view, Count> names{};
+		std::copy_n(list.names.begin(), Count, names.begin());
+		return names;
+	}
+
+	template <MachineKind Kind, size_t StateCount, size_t InputCount, size_t OutputCount, size_t S, size_t T>
+	static constexpr auto Build(const Definition<S, T>& definition)
+	{
+		using Machine = StaticMachine<Kind, StateCount, InputCount, OutputCount>;
+		Machine machine;
+		machine.m_stateNames = ToArray<StateCount>(GatherStates<Kind>(definition));
+		machine.m_inputNames = ToArray<InputCount>(GatherInputs(definition));
+		machine.m_outputNames = ToArray<OutputCount>(GatherOutputs<Kind>(definition));
+
+		if constexpr (Kind == MachineKind::Moore)
+		{
+			for (const auto& state : definition.states)
+			{
+				machine.m_stateOutputs[machine.FindState(state.state)] = machine.FindOutput(state.output);
+			}
+		}
+
+		for (const auto& transition : definition.transitions)
+		{
+			const auto from = machine.FindState(transition.fromState);
+			const auto to = machine.FindState(transition.toState);
+			if (from == Machine::NO_ID || to == Machine::NO_ID)
+			{
+				throw std::invalid_argument("One of the states in transition is not in the machine");
+			}
+
+			const auto input = machine.FindInput(transition.input);
+			auto& cell = machine.m_cells[static_cast<size_t>(from) * InputCount + input];
+			cell.next = to;
+			if constexpr (Kind == MachineKind::Mealy)
+			{
+				cell.output = machine.FindOutput(transition.output);
+			}
+			else
+			{
+				cell.output = machine.m_stateOutputs[to];
+			}
+		}
+
+		if constexpr (S > 0)
+		{
+			machine.m_startState = machine.FindState(definition.states.front().state);
+		}
+		else if constexpr (T > 0)
+		{
+			machine.m_startState = machine.FindState(definition.transitions.front().fromState);
+		}
+
+		return machine;
+	}
+};
+
+// The source is a captureless lambda returning either DOT text (std::string_view) or a std::array of
+// StaticMealyTransition; the first declared state, or else the first transition source, is the start state
+template <typename Source>
+consteval auto MakeStaticMealyMachine(Source)
+{
+	return StaticMachineBuilder::Make<MachineKind::Mealy, Source>();
+}
+
+// The source is a captureless lambda returning either DOT text (std::string_view) or a std::pair of
+// std::array<StaticMooreState> and std::array<StaticMooreTransition>; the first declared state is the start state
+template <typename Source>
+consteval auto MakeStaticMooreMachine(Source)
+{
+	return StaticMachineBuilder::Make<MachineKind::Moore, Source>();
+}
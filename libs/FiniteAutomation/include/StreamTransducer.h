@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+class StreamTransducer
+{
+public:
+	using Id = MachineTable::Id;
+
+	static constexpr size_t DEFAULT_BUFFER_BYTES = size_t{1} << 16;
+
+	struct Result
+	{
+		Id finalState = MachineTable::NO_ID;
+		size_t consumed = 0;
+		size_t emitted = 0;
+	};
+
+	// The table must outlive the transducer
+	explicit StreamTransducer(const MachineTable& table, size_t bufferBytes = DEFAULT_BUFFER_BYTES);
+
+	// Maps the file, reads whitespace-separated input symbols and writes one output name per line.
+	// OnChange lines are "<position> <output>", RunLength lines are "<output> <count>"; emitted counts every output
+	// When an undefined transition throws, the outputs of all inputs before it are written first
+	Result RunFile(const std::string& name, std::ostream& output, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+	Result Run(std::string_view input, std::ostream& output, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw, OutputMode mode = OutputMode::Every) const;
+
+private:
+	const MachineTable& m_table;
+	size_t m_bufferBytes;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+class StrideTable
+{
+public:
+	using Id = MachineTable::Id;
+
+	static constexpr size_t DEFAULT_BUDGET_BYTES = size_t{1} << 18;
+	static constexpr size_t MAX_STRIDE = 8;
+
+	// Precomputes k steps per lookup, with the largest k whose table fits into budgetBytes.
+	// The source table must outlive the stride table
+	explicit StrideTable(const MachineTable& table, size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+	[[nodiscard]] size_t GetStride() const;
+	[[nodiscard]] size_t GetSizeBytes() const;
+
+	[[nodiscard]] MachineTable::RunResult Run(std::span<const Id> inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw) const;
+
+	template <typename OutputSink>
+	size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw) const;
+
+private:
+	struct Entry
+	{
+		Id next = MachineTable::NO_ID;
+		Id steps = 0;
+	};
+
+	const MachineTable& m_table;
+	size_t m_stride = 1;
+	size_t m_wordCount = 1;
+	std::vector<Entry> m_entries;
+	std::vector<Id> m_outputs;
+};
+
+template <typename OutputSink>
+size_t StrideTable::RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy) const
+{
+	const size_t inputCount = m_table.GetInputCount();
+	const size_t stateCount = m_table.GetStateCount();
+	const size_t stride = m_stride;
+
+	size_t position = 0;
+	for (; position + stride <= inputs.size(); position += stride)
+	{
+		size_t word = 0;
+		bool known = true;
+		for (size_t i = 0; i < stride; ++i)
+		{
+			const Id input = inputs[position + i];
+			known = known && input < inputCount;
+			word = word * inputCount + input;
+		}
+
+		if (known && state < stateCount)
+		{
+			const size_t index = static_cast<size_t>(state) * m_wordCount + word;
+			const Entry entry = m_entries[index];
+			if (entry.steps == stride)
+			{
+				const Id* outputs = m_outputs.data() + index * stride;
+				for (size_t i = 0; i < stride; ++i)
+				{
+					sink(outputs[i]);
+				}
+				state = entry.next;
+				continue;
+			}
+		}
+
+		const auto block = inputs.subspan(position, stride);
+		if (const size_t consumed = m_table.RunInto(block, state, sink, policy); consumed < stride)
+		{
+			return position + consumed;
+		}
+	}
+
+	return position + m_table.RunInto(inputs.subspan(position), state, sink, policy);
+}
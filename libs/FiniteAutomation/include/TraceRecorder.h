@@ -0,0 +1,118 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+// Keeps the last capacity steps of one machine instance in a bit-packed ring. A record holds the state before the
+// step (ceil(log2 |states|) bits) and the input (ceil(log2 (|inputs| + 1)) bits, the extra code marks unknown
+// inputs), so every retained step decodes on its own even after older records were overwritten.
+// Capacity is rounded up to a multiple of 64 steps so records never straddle the end of the ring.
+// The table must outlive the recorder
+class TraceRecorder
+{
+public:
+	using Id = MachineTable::Id;
+
+	struct Step
+	{
+		Id state = MachineTable::NO_ID;
+		Id input = MachineTable::NO_ID;
+		Id next = MachineTable::NO_ID;
+		Id output = MachineTable::NO_ID;
+	};
+
+	TraceRecorder(const MachineTable& table, size_t capacity);
+
+	[[nodiscard]] size_t GetCapacity() const;
+	[[nodiscard]] size_t GetBitsPerStep() const;
+	[[nodiscard]] size_t GetSize() const;
+	[[nodiscard]] std::uint64_t GetRecordedCount() const;
+
+	void Clear();
+
+	void Record(Id state, Id input)
+	{
+		Push(m_cursor, state, input);
+		++m_recorded;
+	}
+
+	// Same contract as MachineTable::RunInto, recording every consumed step
+	template <typename OutputSink>
+	size_t RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw);
+
+	// Retained steps from the oldest to the newest, with next state and output looked up in the table.
+	// Steps that left the state unchanged without a transition have output NO_ID
+	[[nodiscard]] std::vector<Step> Decode() const;
+
+	// Writes one "state input -> next / output" line per retained step; "?" stands for an unknown input or no output
+	void WriteReplay(std::ostream& output) const;
+
+private:
+	// The low fill bits of the current word live in bits until the word is complete
+	struct Cursor
+	{
+		std::uint64_t bits = 0;
+		size_t fill = 0;
+		size_t word = 0;
+	};
+
+	void Push(Cursor& cursor, Id state, Id input)
+	{
+		const std::uint64_t code = input < m_inputCount ? input : m_inputCount;
+		const std::uint64_t value = static_cast<std::uint64_t>(state) | code << m_stateBits;
+		cursor.bits |= value << cursor.fill;
+		cursor.fill += m_bitsPerStep;
+		if (cursor.fill >= 64)
+		{
+			m_words[cursor.word] = cursor.bits;
+			if (++cursor.word == m_words.size())
+			{
+				cursor.word = 0;
+			}
+			cursor.fill -= 64;
+			cursor.bits = cursor.fill == 0 ? 0 : value >> (m_bitsPerStep - cursor.fill);
+		}
+	}
+
+	[[nodiscard]] std::uint64_t GetWord(size_t word) const;
+	[[nodiscard]] std::uint64_t Read(size_t slot) const;
+
+	const MachineTable& m_table;
+	size_t m_capacity;
+	size_t m_inputCount;
+	size_t m_stateBits;
+	size_t m_bitsPerStep;
+	std::vector<std::uint64_t> m_words;
+	Cursor m_cursor;
+	std::uint64_t m_recorded = 0;
+};
+
+template <typename OutputSink>
+size_t TraceRecorder::RunInto(std::span<const Id> inputs, Id& state, OutputSink&& sink, UndefinedTransitionPolicy policy)
+{
+	// A local cursor stays in registers; it is written back whether the run returns or throws
+	Cursor cursor = m_cursor;
+	std::uint64_t recorded = 0;
+	const auto onStep = [&](Id from, Id input, size_t) {
+		Push(cursor, from, input);
+		++recorded;
+	};
+	try
+	{
+		const size_t consumed = m_table.RunInto(inputs, state, sink, onStep, policy);
+		m_cursor = cursor;
+		m_recorded += recorded;
+		return consumed;
+	}
+	catch (...)
+	{
+		m_cursor = cursor;
+		m_recorded += recorded;
+		throw;
+	}
+}
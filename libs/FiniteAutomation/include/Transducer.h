@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Generator.h"
+#include "MachineTable.h"
+
+#include <algorithm>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Coroutine stages over a MachineTable that must outlive them. Stages pull their inputs lazily, so they chain as
+// TransduceMealy(b, TransduceMealy(a, TokenizeInputs(a, text)) | std::views::transform(...)) without buffers
+
+// Yields the input id of every whitespace-separated token, NO_ID for names the table does not know
+inline Generator<MachineTable::Id> TokenizeInputs(const MachineTable& table, std::string_view text)
+{
+	size_t pos = 0;
+	while (true)
+	{
+		pos = text.find_first_not_of(" \t\r\n", pos);
+		if (pos == std::string_view::npos)
+		{
+			co_return;
+		}
+		const size_t end = std::min(text.find_first_of(" \t\r\n", pos), text.size());
+		co_yield table.FindInput(text.substr(pos, end - pos));
+		pos = end;
+	}
+}
+
+// Maps the output ids of one table to the input ids of the next one by name; NO_ID where the name is unknown
+inline std::vector<MachineTable::Id> MapOutputsToInputs(const MachineTable& from, const MachineTable& to)
+{
+	std::vector<MachineTable::Id> mapping(from.GetOutputCount());
+	for (MachineTable::Id output = 0; output < mapping.size(); ++output)
+	{
+		mapping[output] = to.FindInput(from.GetOutputName(output));
+	}
+	return mapping;
+}
+
+template <std::ranges::input_range Inputs>
+Generator<MachineTable::Id> TransduceMealyView(const MachineTable& table, Inputs inputs, UndefinedTransitionPolicy policy)
+{
+	MachineTable::Id state = table.GetStartState();
+	if (state == MachineTable::NO_ID)
+	{
+		throw std::runtime_error("Machine has no start state");
+	}
+
+	for (const MachineTable::Id input : inputs)
+	{
+		bool emitted = false;
+		MachineTable::Id output = MachineTable::NO_ID;
+		const size_t consumed = table.RunInto(std::span(&input, 1), state, [&](MachineTable::Id value) {
+			output = value;
+			emitted = true;
+		}, policy);
+
+		if (consumed == 0)
+		{
+			co_return;
+		}
+		if (emitted)
+		{
+			co_yield output;
+		}
+	}
+}
+
+template <std::ranges::input_range Inputs>
+Generator<MachineTable::Id> TransduceMooreView(const MachineTable& table, Inputs inputs, UndefinedTransitionPolicy policy)
+{
+	if (table.GetKind() != MachineKind::Moore)
+	{
+		throw std::invalid_argument("Machine is not a Moore machine");
+	}
+
+	MachineTable::Id state = table.GetStartState();
+	if (state == MachineTable::NO_ID)
+	{
+		throw std::runtime_error("Machine has no start state");
+	}
+
+	for (const MachineTable::Id input : inputs)
+	{
+		bool moved = false;
+		const size_t consumed = table.RunInto(std::span(&input, 1), state, [&](MachineTable::Id) { moved = true; }, policy);
+
+		if (consumed == 0)
+		{
+			co_return;
+		}
+		if (moved)
+		{
+			co_yield table.GetStateOutput(state);
+		}
+	}
+}
+
+// Yields the output of every transition taken
+template <std::ranges::viewable_range Inputs>
+Generator<MachineTable::Id> TransduceMealy(const MachineTable& table, Inputs&& inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw)
+{
+	return TransduceMealyView(table, std::views::all(std::forward<Inputs>(inputs)), policy);
+}
+
+// Yields the output of every state entered, as MachineTable::Run emits them; the start state output is not yielded
+template <std::ranges::viewable_range Inputs>
+Generator<MachineTable::Id> TransduceMoore(const MachineTable& table, Inputs&& inputs, UndefinedTransitionPolicy policy = UndefinedTransitionPolicy::Throw)
+{
+	return TransduceMooreView(table, std::views::all(std::forward<Inputs>(inputs)), policy);
+}
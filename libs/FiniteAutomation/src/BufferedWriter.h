@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Collects text in a fixed-size buffer and passes it to the stream in large writes; text longer than the buffer
+// is written directly. Flush must be called once the text is complete and throws if the stream has failed
+class BufferedWriter
+{
+public:
+	static constexpr size_t DEFAULT_CAPACITY = size_t{1} << 16;
+
+	explicit BufferedWriter(std::ostream& output, size_t capacity = DEFAULT_CAPACITY)
+		: m_output(output)
+		, m_capacity(capacity)
+	{
+		m_buffer.reserve(m_capacity);
+	}
+
+	BufferedWriter& operator<<(std::string_view text)
+	{
+		if (m_buffer.size() + text.size() > m_capacity)
+		{
+			WriteBuffer();
+			if (text.size() > m_capacity)
+			{
+				m_output.write(text.data(), static_cast<std::streamsize>(text.size()));
+				return *this;
+			}
+		}
+		m_buffer.append(text);
+		return *this;
+	}
+
+	BufferedWriter& operator<<(char ch)
+	{
+		return *this << std::string_view(&ch, 1);
+	}
+
+	void Flush()
+	{
+		WriteBuffer();
+		m_output.flush();
+		if (!m_output)
+		{
+			throw std::runtime_error("Failed to write output");
+		}
+	}
+
+private:
+	void WriteBuffer()
+	{
+		m_output.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+		m_buffer.clear();
+	}
+
+	std::ostream& m_output;
+	size_t m_capacity;
+	std::string m_buffer;
+};
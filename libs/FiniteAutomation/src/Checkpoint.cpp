@@ -0,0 +1,231 @@
+#include "Checkpoint.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+using Id = MachineTable::Id;
+using SessionId = SessionEngine::SessionId;
+
+constexpr std::array<char, 8> CHECKPOINT_MAGIC = {'F', 'A', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr std::uint32_t CHECKPOINT_VERSION = 2;
+
+struct CheckpointHeader
+{
+	std::array<char, 8> magic = CHECKPOINT_MAGIC;
+	std::uint32_t version = CHECKPOINT_VERSION;
+	CheckpointKind kind = CheckpointKind::Full;
+	std::uint64_t fingerprint = 0;
+	std::uint64_t sessionCount = 0;
+	std::uint64_t recordCount = 0;
+	std::uint64_t sequence = 0;
+	// Sequence of the checkpoint an incremental one was written after; 0 for a full checkpoint
+	std::uint64_t baseSequence = 0;
+};
+
+struct SessionRecord
+{
+	SessionId session = 0;
+	Id state = MachineTable::NO_ID;
+};
+
+static_assert(sizeof(CheckpointHeader) == 56);
+static_assert(sizeof(SessionRecord) == 8);
+
+void WriteFile(const std::string& name, const CheckpointHeader& header, const void* records, size_t size)
+{
+	const std::string temporaryName = name + ".tmp";
+	std::error_code error;
+	{
+		std::ofstream file(temporaryName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Cannot open file: " + temporaryName);
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(records), static_cast<std::streamsize>(size));
+		file.close();
+		if (!file)
+		{
+			std::filesystem::remove(temporaryName, error);
+			throw std::runtime_error("Cannot write file: " + name);
+		}
+	}
+
+	std::filesystem::rename(temporaryName, name, error);
+	if (error)
+	{
+		std::filesystem::remove(temporaryName, error);
+		throw std::runtime_error("Cannot write file: " + name);
+	}
+}
+
+struct CheckpointView
+{
+	CheckpointHeader header;
+	const char* records = nullptr;
+};
+
+CheckpointView ReadHeader(const MappedFile& file, const std::string& name, const MachineTable& table)
+{
+	CheckpointView view;
+	if (file.GetSize() < sizeof(CheckpointHeader))
+	{
+		throw std::runtime_error("Invalid checkpoint file: " + name);
+	}
+	std::memcpy(&view.header, file.GetData(), sizeof(CheckpointHeader));
+	view.records = file.GetData() + sizeof(CheckpointHeader);
+
+	const auto& header = view.header;
+	const size_t recordSize = header.kind == CheckpointKind::Full ? sizeof(Id) : sizeof(SessionRecord);
+	if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION
+		|| (header.kind != CheckpointKind::Full && header.kind != CheckpointKind::Incremental)
+		|| (header.kind == CheckpointKind::Full && (header.recordCount != header.sessionCount || header.baseSequence != 0))
+		|| header.recordCount > (file.GetSize() - sizeof(CheckpointHeader)) / recordSize
+		|| file.GetSize() != sizeof(CheckpointHeader) + header.recordCount * recordSize)
+	{
+		throw std::runtime_error("Invalid checkpoint file: " + name);
+	}
+	if (header.fingerprint != table.GetFingerprint())
+	{
+		throw std::runtime_error("Checkpoint " + name + " was written for a different machine");
+	}
+
+	return view;
+}
+
+void CheckState(const MachineTable& table, Id state, const std::string& name)
+{
+	if (state >= table.GetStateCount())
+	{
+		throw std::runtime_error("Invalid state id in checkpoint file: " + name);
+	}
+}
+
+void WriteFullCheckpoint(const std::string& name, const MachineTable& table, std::span<const Id> states, std::uint64_t sequence)
+{
+	CheckpointHeader header;
+	header.fingerprint = table.GetFingerprint();
+	header.sessionCount = states.size();
+	header.recordCount = states.size();
+	header.sequence = sequence;
+	WriteFile(name, header, states.data(), states.size_bytes());
+}
+} // namespace
+
+void WriteCheckpoint(const std::string& name, const MachineTable& table, std::span<const MachineTable::Id> states)
+{
+	WriteFullCheckpoint(name, table, states, 0);
+}
+
+std::vector<MachineTable::Id> RestoreCheckpoint(const std::string& name, const MachineTable& table)
+{
+	const MappedFile file(name);
+	const auto view = ReadHeader(file, name, table);
+	if (view.header.kind != CheckpointKind::Full)
+	{
+		throw std::runtime_error("Checkpoint " + name + " is incremental and needs a session engine to apply to");
+	}
+
+	std::vector<Id> states(view.header.recordCount);
+	std::memcpy(states.data(), view.records, states.size() * sizeof(Id));
+	for (const Id state : states)
+	{
+		CheckState(table, state, name);
+	}
+	return states;
+}
+
+void WriteCheckpoint(const std::string& name, SessionEngine& engine, CheckpointKind kind)
+{
+	const std::uint64_t sequence = engine.GetCheckpointSequence() + 1;
+	if (kind == CheckpointKind::Full)
+	{
+		WriteFullCheckpoint(name, engine.GetTable(), engine.GetStates(), sequence);
+		engine.ClearChanges();
+		engine.SetCheckpointSequence(sequence);
+		return;
+	}
+
+	const auto states = engine.GetStates();
+	std::vector<SessionRecord> records;
+	for (const SessionId session : engine.GetChangedSessions())
+	{
+		records.push_back({session, states[session]});
+	}
+
+	CheckpointHeader header;
+	header.kind = CheckpointKind::Incremental;
+	header.fingerprint = engine.GetTable().GetFingerprint();
+	header.sessionCount = states.size();
+	header.recordCount = records.size();
+	header.sequence = sequence;
+	header.baseSequence = engine.GetCheckpointSequence();
+	WriteFile(name, header, records.data(), records.size() * sizeof(SessionRecord));
+	engine.ClearChanges();
+	engine.SetCheckpointSequence(sequence);
+}
+
+void RestoreCheckpoint(const std::string& name, SessionEngine& engine)
+{
+	const auto& table = engine.GetTable();
+	const MappedFile file(name);
+	const auto view = ReadHeader(file, name, table);
+	const auto& header = view.header;
+
+	if (header.sessionCount < engine.GetSessionCount())
+	{
+		throw std::runtime_error("Checkpoint " + name + " holds fewer sessions than the engine");
+	}
+	// Sessions added since the previous checkpoint are marked changed, so each of them has a record
+	if (header.sessionCount - engine.GetSessionCount() > header.recordCount
+		|| header.sessionCount > std::numeric_limits<SessionId>::max())
+	{
+		throw std::runtime_error("Invalid checkpoint file: " + name);
+	}
+	if (header.kind == CheckpointKind::Incremental && header.baseSequence != engine.GetCheckpointSequence())
+	{
+		throw std::runtime_error("Checkpoint " + name + " applies after checkpoint " + std::to_string(header.baseSequence)
+			+ ", but the engine is at checkpoint " + std::to_string(engine.GetCheckpointSequence()));
+	}
+
+	const auto readRecord = [&](size_t index) {
+		SessionRecord record;
+		if (header.kind == CheckpointKind::Full)
+		{
+			record.session = static_cast<SessionId>(index);
+			std::memcpy(&record.state, view.records + index * sizeof(Id), sizeof(Id));
+		}
+		else
+		{
+			std::memcpy(&record, view.records + index * sizeof(SessionRecord), sizeof(SessionRecord));
+		}
+		return record;
+	};
+
+	for (size_t i = 0; i < header.recordCount; ++i)
+	{
+		const auto record = readRecord(i);
+		if (record.session >= header.sessionCount)
+		{
+			throw std::runtime_error("Invalid session id in checkpoint file: " + name);
+		}
+		CheckState(table, record.state, name);
+	}
+
+	engine.AddSessions(header.sessionCount - engine.GetSessionCount());
+	for (size_t i = 0; i < header.recordCount; ++i)
+	{
+		const auto record = readRecord(i);
+		engine.SetState(record.session, record.state);
+	}
+	engine.ClearChanges();
+	engine.SetCheckpointSequence(header.sequence);
+}
@@ -0,0 +1,125 @@
+#include "CoverageCounters.h"
+#include "MealyMachine.h"
+#include "MooreMachine.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+constexpr std::string_view ARROW = " -> ";
+constexpr std::string_view LABEL_BEGIN = " [label = \"";
+constexpr std::string_view LABEL_END = "\"]";
+
+// Rewrites the transition lines "from -> to [label = "..."]" of a DOT string produced by ToDotString
+std::string OverlayCounts(const std::string& dot, const MachineTable& table, std::span<const std::uint64_t> hits, bool labelHasOutput)
+{
+	if (hits.size() != table.GetCells().size())
+	{
+		throw std::invalid_argument("Hit counters do not match the machine");
+	}
+
+	std::istringstream lines(dot);
+	std::ostringstream oss;
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		const size_t arrow = line.find(ARROW);
+		const size_t labelBegin = line.find(LABEL_BEGIN);
+		if (arrow == std::string::npos || labelBegin == std::string::npos || !line.ends_with(LABEL_END))
+		{
+			oss << line << '\n';
+			continue;
+		}
+
+		const std::string_view from(line.data(), arrow);
+		const size_t labelStart = labelBegin + LABEL_BEGIN.size();
+		const std::string_view label(line.data() + labelStart, line.size() - LABEL_END.size() - labelStart);
+		const std::string_view input = labelHasOutput ? label.substr(0, label.find('/')) : label;
+
+		const MachineTable::Id state = table.FindState(from);
+		const MachineTable::Id inputId = table.FindInput(input);
+		const std::uint64_t count = state == MachineTable::NO_ID || inputId == MachineTable::NO_ID
+			? 0
+			: hits[static_cast<size_t>(state) * table.GetInputCount() + inputId];
+
+		oss << std::string_view(line).substr(0, labelStart) << label << "\\n" << count << '"';
+		if (count == 0)
+		{
+			oss << ", style = dashed";
+		}
+		oss << "]\n";
+	}
+	return oss.str();
+}
+} // namespace
+
+CoverageCounters::CoverageCounters(const MachineTable& table, size_t threadCount, std::uint32_t sampleInterval)
+	: m_table(table)
+	, m_cellCount(table.GetCells().size())
+	, m_stride((m_cellCount + COUNTERS_PER_LINE - 1) / COUNTERS_PER_LINE * COUNTERS_PER_LINE + COUNTERS_PER_LINE)
+	, m_sampleInterval(sampleInterval)
+{
+	if (threadCount == 0)
+	{
+		throw std::invalid_argument("Coverage counters need at least one thread");
+	}
+	if (sampleInterval == 0)
+	{
+		throw std::invalid_argument("Sample interval must be positive");
+	}
+	m_counters = std::vector<std::atomic<std::uint64_t>>(threadCount * m_stride);
+	m_samplers.assign(threadCount, Sampler{sampleInterval});
+}
+
+size_t CoverageCounters::GetThreadCount() const
+{
+	return m_samplers.size();
+}
+
+std::uint32_t CoverageCounters::GetSampleInterval() const
+{
+	return m_sampleInterval;
+}
+
+std::vector<std::uint64_t> CoverageCounters::Merge() const
+{
+	std::vector<std::uint64_t> hits(m_cellCount, 0);
+	for (size_t thread = 0; thread < m_samplers.size(); ++thread)
+	{
+		const auto* counters = m_counters.data() + thread * m_stride;
+		for (size_t cell = 0; cell < m_cellCount; ++cell)
+		{
+			hits[cell] += counters[cell].load(std::memory_order_relaxed);
+		}
+	}
+	return hits;
+}
+
+void CoverageCounters::Clear()
+{
+	for (auto& counter : m_counters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+	std::ranges::fill(m_samplers, Sampler{m_sampleInterval});
+}
+
+void CoverageCounters::CheckThread(size_t thread) const
+{
+	if (thread >= m_samplers.size())
+	{
+		throw std::out_of_range("Unknown coverage thread " + std::to_string(thread));
+	}
+}
+
+std::string ToCoverageDotString(const MealyMachine& machine, std::span<const std::uint64_t> hits)
+{
+	return OverlayCounts(machine.ToDotString(), MachineTable(machine), hits, true);
+}
+
+std::string ToCoverageDotString(const MooreMachine& machine, std::span<const std::uint64_t> hits)
+{
+	return OverlayCounts(machine.ToDotString(), MachineTable(machine), hits, false);
+}
@@ -0,0 +1,171 @@
+#include "CppSourceWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+using Id = MachineTable::Id;
+
+// C++20 keywords and alternative operator tokens, sorted for binary search
+constexpr std::array<std::string_view, 92> RESERVED_WORDS = {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+	"char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield", "compl", "concept", "const",
+	"const_cast", "consteval", "constexpr", "constinit", "continue", "decltype", "default", "delete", "do", "double",
+	"dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+	"inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+	"or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+	"sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw",
+	"true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+	"wchar_t", "while", "xor", "xor_eq",
+};
+
+bool IsIdentifier(const std::string& name)
+{
+	if (name.empty() || std::isdigit(static_cast<unsigned char>(name.front())))
+	{
+		return false;
+	}
+	// Names with a double underscore or starting with an underscore and a capital letter belong to the implementation
+	if (name.find("__") != std::string::npos || (name.size() > 1 && name[0] == '_' && std::isupper(static_cast<unsigned char>(name[1]))))
+	{
+		return false;
+	}
+	if (std::ranges::binary_search(RESERVED_WORDS, std::string_view(name)))
+	{
+		return false;
+	}
+	for (const char ch : name)
+	{
+		if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '_')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string ToLiteral(std::string_view value)
+{
+	std::ostringstream oss;
+	oss << '"';
+	for (const char ch : value)
+	{
+		const auto code = static_cast<unsigned char>(ch);
+		if (ch == '"' || ch == '\\')
+		{
+			oss << '\\' << ch;
+		}
+		else if (code < 0x20 || code >= 0x7f)
+		{
+			oss << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned>(code) << std::dec;
+		}
+		else
+		{
+			oss << ch;
+		}
+	}
+	oss << '"';
+	return oss.str();
+}
+
+void WriteNames(std::ostream& out, const char* arrayName, size_t count, auto getName)
+{
+	// std::array has the exact length even for an empty table, where a built-in array would need a placeholder
+	out << "inline constexpr std::array<std::string_view, " << count << "> " << arrayName << " = {";
+	for (Id id = 0; id < count; ++id)
+	{
+		out << (id == 0 ? "" : ", ") << ToLiteral(getName(id));
+	}
+	out << "};" << std::endl;
+}
+} // namespace
+
+std::string WriteCppSource(const MachineTable& table, const std::string& name)
+{
+	if (!IsIdentifier(name))
+	{
+		throw std::invalid_argument("Invalid C++ identifier: " + name);
+	}
+
+	const bool isMoore = table.GetKind() == MachineKind::Moore;
+	std::ostringstream out;
+
+	out << "#pragma once" << std::endl
+		<< std::endl
+		<< "#include <array>" << std::endl
+		<< "#include <cstdint>" << std::endl
+		<< "#include <string_view>" << std::endl
+		<< std::endl
+		<< "namespace " << name << std::endl
+		<< "{" << std::endl
+		<< "inline constexpr std::uint32_t NO_ID = 0xFFFFFFFFu;" << std::endl
+		<< "inline constexpr std::uint32_t STATE_COUNT = " << table.GetStateCount() << "u;" << std::endl
+		<< "inline constexpr std::uint32_t INPUT_COUNT = " << table.GetInputCount() << "u;" << std::endl
+		<< "inline constexpr std::uint32_t OUTPUT_COUNT = " << table.GetOutputCount() << "u;" << std::endl
+		<< "inline constexpr std::uint32_t START_STATE = " << (table.GetStartState() == MachineTable::NO_ID ? std::string("NO_ID") : std::to_string(table.GetStartState()) + "u") << ";" << std::endl
+		<< std::endl;
+
+	WriteNames(out, "STATE_NAMES", table.GetStateCount(), [&](Id id) { return table.GetStateName(id); });
+	WriteNames(out, "INPUT_NAMES", table.GetInputCount(), [&](Id id) { return table.GetInputName(id); });
+	WriteNames(out, "OUTPUT_NAMES", table.GetOutputCount(), [&](Id id) { return table.GetOutputName(id); });
+	out << std::endl;
+
+	if (isMoore)
+	{
+		out << "constexpr std::uint32_t GetStateOutput(std::uint32_t state)" << std::endl
+			<< "{" << std::endl
+			<< "\tswitch (state)" << std::endl
+			<< "\t{" << std::endl;
+		for (Id state = 0; state < table.GetStateCount(); ++state)
+		{
+			const Id output = table.GetStateOutput(state);
+			out << "\tcase " << state << "u:" << std::endl
+				<< "\t\treturn " << (output == MachineTable::NO_ID ? std::string("NO_ID") : std::to_string(output) + "u") << ";" << std::endl;
+		}
+		out << "\tdefault:" << std::endl
+			<< "\t\treturn NO_ID;" << std::endl
+			<< "\t}" << std::endl
+			<< "}" << std::endl
+			<< std::endl;
+	}
+
+	out << "// Returns false and leaves state unchanged when the transition is undefined" << std::endl
+		<< "constexpr bool Step(std::uint32_t& state, std::uint32_t input, [[maybe_unused]] std::uint32_t& output)" << std::endl
+		<< "{" << std::endl
+		<< "\tswitch (state)" << std::endl
+		<< "\t{" << std::endl;
+	for (Id state = 0; state < table.GetStateCount(); ++state)
+	{
+		out << "\tcase " << state << "u:" << std::endl
+			<< "\t\tswitch (input)" << std::endl
+			<< "\t\t{" << std::endl;
+		for (Id input = 0; input < table.GetInputCount(); ++input)
+		{
+			const auto cell = table.GetCell(state, input);
+			if (cell.next == MachineTable::NO_ID)
+			{
+				continue;
+			}
+			out << "\t\tcase " << input << "u:" << std::endl
+				<< "\t\t\tstate = " << cell.next << "u;" << std::endl
+				<< "\t\t\toutput = " << cell.output << "u;" << std::endl
+				<< "\t\t\treturn true;" << std::endl;
+		}
+		out << "\t\tdefault:" << std::endl
+			<< "\t\t\treturn false;" << std::endl
+			<< "\t\t}" << std::endl;
+	}
+	out << "\tdefault:" << std::endl
+		<< "\t\treturn false;" << std::endl
+		<< "\t}" << std::endl
+		<< "}" << std::endl
+		<< "} // namespace " << name << std::endl;
+
+	return out.str();
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "MachineTable.h"
+
+#include <string>
+
+std::string WriteCppSource(const MachineTable& table, const std::string& name);
@@ -0,0 +1,164 @@
+#include "LockstepRunner.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+using Id = LockstepRunner::Id;
+using Cell = MachineTable::Cell;
+} // namespace
+
+LockstepRunner::LockstepRunner(std::span<const MachineTable> tables)
+{
+	for (const auto& table : tables)
+	{
+		for (Id input = 0; input < table.GetInputCount(); ++input)
+		{
+			m_inputNames.emplace_back(table.GetInputName(input));
+		}
+	}
+	std::ranges::sort(m_inputNames);
+	m_inputNames.erase(std::unique(m_inputNames.begin(), m_inputNames.end()), m_inputNames.end());
+
+	const size_t machineCount = tables.size();
+	const size_t inputCount = m_inputNames.size();
+
+	size_t cellCount = 0;
+	for (const auto& table : tables)
+	{
+		cellCount += table.GetStateCount() * (table.GetInputCount() + 1);
+	}
+	m_cells.reserve(cellCount);
+	m_columns.resize((inputCount + 1) * machineCount);
+
+	for (size_t machine = 0; machine < machineCount; ++machine)
+	{
+		const auto& table = tables[machine];
+		const size_t columnCount = table.GetInputCount() + 1;
+		m_machines.push_back({m_cells.size(), columnCount, table.GetStateCount(), table.GetStartState()});
+
+		const auto cells = table.GetCells();
+		for (size_t state = 0; state < table.GetStateCount(); ++state)
+		{
+			const auto row = cells.subspan(state * table.GetInputCount(), table.GetInputCount());
+			m_cells.insert(m_cells.end(), row.begin(), row.end());
+			m_cells.emplace_back();
+		}
+
+		for (size_t input = 0; input <= inputCount; ++input)
+		{
+			const Id column = input < inputCount ? table.FindInput(m_inputNames[input]) : MachineTable::NO_ID;
+			m_columns[input * machineCount + machine] = column == MachineTable::NO_ID ? static_cast<Id>(columnCount - 1) : column;
+		}
+
+		auto& outputNames = m_outputNames.emplace_back();
+		for (Id output = 0; output < table.GetOutputCount(); ++output)
+		{
+			outputNames.emplace_back(table.GetOutputName(output));
+		}
+	}
+}
+
+size_t LockstepRunner::GetMachineCount() const
+{
+	return m_machines.size();
+}
+
+size_t LockstepRunner::GetInputCount() const
+{
+	return m_inputNames.size();
+}
+
+std::string_view LockstepRunner::GetInputName(Id input) const
+{
+	if (input >= m_inputNames.size())
+	{
+		throw std::out_of_range("Unknown input id " + std::to_string(input));
+	}
+	return m_inputNames[input];
+}
+
+LockstepRunner::Id LockstepRunner::FindInput(std::string_view name) const
+{
+	const auto it = std::ranges::lower_bound(m_inputNames, name, {}, [](const std::string& value) { return std::string_view(value); });
+	return it != m_inputNames.end() && *it == name ? static_cast<Id>(it - m_inputNames.begin()) : MachineTable::NO_ID;
+}
+
+std::vector<LockstepRunner::Id> LockstepRunner::EncodeInputs(std::span<const std::string> inputs) const
+{
+	std::vector<Id> ids;
+	ids.reserve(inputs.size());
+	for (const auto& input : inputs)
+	{
+		ids.push_back(FindInput(input));
+	}
+	return ids;
+}
+
+std::string_view LockstepRunner::GetOutputName(size_t machine, Id output) const
+{
+	if (machine >= m_outputNames.size() || output >= m_outputNames[machine].size())
+	{
+		throw std::out_of_range("Unknown output id " + std::to_string(output));
+	}
+	return m_outputNames[machine][output];
+}
+
+std::vector<LockstepRunner::Id> LockstepRunner::GetStartStates() const
+{
+	std::vector<Id> states;
+	for (const auto& machine : m_machines)
+	{
+		states.push_back(machine.startState);
+	}
+	return states;
+}
+
+LockstepRunner::RunResult LockstepRunner::Run(std::span<const Id> inputs) const
+{
+	RunResult result;
+	result.finalStates = GetStartStates();
+	result.outputs.resize(inputs.size() * m_machines.size());
+	Run(inputs, result.finalStates, result.outputs);
+	return result;
+}
+
+void LockstepRunner::Run(std::span<const Id> inputs, std::span<Id> states, std::span<Id> outputs) const
+{
+	const size_t machineCount = m_machines.size();
+	if (states.size() != machineCount || outputs.size() < inputs.size() * machineCount)
+	{
+		throw std::invalid_argument("States must hold one id per machine and outputs one id per machine and step");
+	}
+	for (size_t machine = 0; machine < machineCount; ++machine)
+	{
+		if (states[machine] == MachineTable::NO_ID)
+		{
+			throw std::runtime_error("Machine has no start state");
+		}
+		if (states[machine] >= m_machines[machine].stateCount)
+		{
+			throw std::out_of_range("Unknown state id " + std::to_string(states[machine]));
+		}
+	}
+
+	const Machine* machines = m_machines.data();
+	const Cell* cells = m_cells.data();
+	const size_t unknownInput = m_inputNames.size();
+
+	for (size_t step = 0; step < inputs.size(); ++step)
+	{
+		const Id* columns = m_columns.data() + std::min<size_t>(inputs[step], unknownInput) * machineCount;
+		Id* stepOutputs = outputs.data() + step * machineCount;
+
+		for (size_t machine = 0; machine < machineCount; ++machine)
+		{
+			const Machine& info = machines[machine];
+			const Cell cell = cells[info.firstCell + static_cast<size_t>(states[machine]) * info.columnCount + columns[machine]];
+			states[machine] = cell.next != MachineTable::NO_ID ? cell.next : states[machine];
+			stepOutputs[machine] = cell.output;
+		}
+	}
+}
@@ -0,0 +1,1048 @@
+#include "MachineTable.h"
+#include "DotScanner.h"
+#include "MappedFile.h"
+#include "MealyMachine.h"
+#include "MooreMachine.h"
+#include "ParallelUtils.h"
+#include "Prefetch.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace
+{
+using Id = MachineTable::Id;
+
+constexpr size_t BATCH_LANES = 16;
+constexpr size_t MAX_SPECULATIVE_STATES = 1024;
+constexpr size_t SPECULATION_MERGE_INTERVAL = 64;
+constexpr size_t MIN_DOT_CHUNK_BYTES = size_t{1} << 20;
+constexpr std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+template <typename Names>
+std::vector<std::string> ToSortedNames(const Names& names)
+{
+	const std::set<std::string> sorted(names.begin(), names.end());
+	return {sorted.begin(), sorted.end()};
+}
+
+Id Find(const auto& index, std::string_view name)
+{
+	const auto it = index.find(name);
+	return it == index.end() ? MachineTable::NO_ID : it->second;
+}
+
+void HashBytes(std::uint64_t& hash, const void* data, size_t size)
+{
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+}
+
+void HashValue(std::uint64_t& hash, std::uint64_t value)
+{
+	HashBytes(hash, &value, sizeof(value));
+}
+
+void HashNames(std::uint64_t& hash, const std::vector<std::string>& names)
+{
+	HashValue(hash, names.size());
+	for (const auto& name : names)
+	{
+		HashValue(hash, name.size());
+		HashBytes(hash, name.data(), name.size());
+	}
+}
+
+std::string_view GetName(const std::vector<std::string>& names, Id id, const char* kind)
+{
+	if (id >= names.size())
+	{
+		throw std::out_of_range(std::string("Unknown ") + kind + " id " + std::to_string(id));
+	}
+	return names[id];
+}
+
+// Gives names ids in order of first appearance; the views must outlive the interner.
+// Open addressing over flat slots that keep the hash, the length and the first bytes of every name, so that most
+// lookups compare names without touching the scanned text
+class NameInterner
+{
+public:
+	Id Intern(std::string_view name)
+	{
+		const size_t hash = std::hash<std::string_view>{}(name);
+		Slot& slot = FindSlot(name, hash);
+		if (slot.id != MachineTable::NO_ID)
+		{
+			return slot.id;
+		}
+
+		slot.hash = hash;
+		slot.id = static_cast<Id>(m_names.size());
+		slot.size = name.size();
+		name.copy(slot.prefix.data(), slot.prefix.size());
+		m_names.push_back(name);
+		if (m_names.size() * 2 > m_slots.size())
+		{
+			Grow();
+		}
+		return static_cast<Id>(m_names.size() - 1);
+	}
+
+	[[nodiscard]] Id Find(std::string_view name)
+	{
+		return FindSlot(name, std::hash<std::string_view>{}(name)).id;
+	}
+
+	[[nodiscard]] size_t GetSize() const
+	{
+		return m_names.size();
+	}
+
+	[[nodiscard]] std::string_view GetName(Id id) const
+	{
+		return m_names[id];
+	}
+
+	// Copies the used names in sorted order and fills newIds with the sorted position of every interned id
+	[[nodiscard]] std::vector<std::string> TakeSorted(const std::vector<bool>& used, std::vector<Id>& newIds) const
+	{
+		std::vector<Id> order;
+		order.reserve(m_names.size());
+		for (Id id = 0; id < m_names.size(); ++id)
+		{
+			if (used[id])
+			{
+				order.push_back(id);
+			}
+		}
+		std::ranges::sort(order, [this](Id left, Id right) { return m_names[left] < m_names[right]; });
+
+		std::vector<std::string> names;
+		names.reserve(order.size());
+		newIds.assign(m_names.size(), MachineTable::NO_ID);
+		for (const Id id : order)
+		{
+			newIds[id] = static_cast<Id>(names.size());
+			names.emplace_back(m_names[id]);
+		}
+		return names;
+	}
+
+private:
+	static constexpr size_t INITIAL_SLOTS = 64;
+	static constexpr size_t PREFIX_SIZE = 16;
+
+	struct Slot
+	{
+		size_t hash = 0;
+		Id id = MachineTable::NO_ID;
+		std::uint32_t size = 0;
+		std::array<char, PREFIX_SIZE> prefix{};
+	};
+
+	[[nodiscard]] bool Matches(const Slot& slot, std::string_view name, size_t hash) const
+	{
+		if (slot.hash != hash || slot.size != name.size())
+		{
+			return false;
+		}
+		const size_t prefixSize = std::min(name.size(), PREFIX_SIZE);
+		return std::string_view(slot.prefix.data(), prefixSize) == name.substr(0, prefixSize)
+			&& (name.size() <= PREFIX_SIZE || m_names[slot.id] == name);
+	}
+
+	Slot& FindSlot(std::string_view name, size_t hash)
+	{
+		if (m_slots.empty())
+		{
+			m_slots.resize(INITIAL_SLOTS);
+		}
+		const size_t mask = m_slots.size() - 1;
+		for (size_t index = hash & mask;; index = (index + 1) & mask)
+		{
+			Slot& slot = m_slots[index];
+			if (slot.id == MachineTable::NO_ID || Matches(slot, name, hash))
+			{
+				return slot;
+			}
+		}
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> slots(m_slots.size() * 2);
+		const size_t mask = slots.size() - 1;
+		for (const Slot& slot : m_slots)
+		{
+			if (slot.id == MachineTable::NO_ID)
+			{
+				continue;
+			}
+			size_t index = slot.hash & mask;
+			while (slots[index].id != MachineTable::NO_ID)
+			{
+				index = (index + 1) & mask;
+			}
+			slots[index] = slot;
+		}
+		m_slots = std::move(slots);
+	}
+
+	std::vector<Slot> m_slots;
+	std::vector<std::string_view> m_names;
+};
+
+struct DotTransition
+{
+	Id from = MachineTable::NO_ID;
+	Id input = MachineTable::NO_ID;
+	Id to = MachineTable::NO_ID;
+	Id output = MachineTable::NO_ID;
+};
+
+struct DotDeclaration
+{
+	Id node = MachineTable::NO_ID;
+	Id state = MachineTable::NO_ID;
+	Id output = MachineTable::NO_ID;
+};
+
+struct DotEdge
+{
+	Id fromNode = MachineTable::NO_ID;
+	Id toNode = MachineTable::NO_ID;
+	Id input = MachineTable::NO_ID;
+	Id output = MachineTable::NO_ID;
+	// Declarations of the chunk preceding the edge; they decide which state a redeclared node stands for
+	size_t declarationsBefore = 0;
+};
+
+// Statements of one chunk of a DOT file with ids local to the chunk. Nodes are not resolved, since they may be
+// declared in an earlier chunk
+struct DotChunk
+{
+	NameInterner nodes;
+	NameInterner states;
+	NameInterner inputs;
+	NameInterner outputs;
+	std::vector<DotDeclaration> declarations;
+	std::vector<DotEdge> edges;
+	// Set by a Mealy transition label without "input/output"
+	bool failed = false;
+};
+
+// States, inputs and outputs of a whole file with transitions between resolved states, in file order
+struct DotDefinition
+{
+	NameInterner states;
+	NameInterner inputs;
+	NameInterner outputs;
+	std::vector<Id> stateOutputs;
+	std::vector<DotTransition> transitions;
+	Id startState = MachineTable::NO_ID;
+};
+
+// Splits text into about chunkCount pieces that end right after a newline
+std::vector<std::string_view> SplitAtLines(std::string_view text, size_t chunkCount)
+{
+	std::vector<std::string_view> chunks;
+	size_t begin = 0;
+	for (size_t chunk = 1; chunk <= chunkCount && begin < text.size(); ++chunk)
+	{
+		size_t end = std::max(begin, text.size() / chunkCount * chunk);
+		if (chunk == chunkCount || end >= text.size())
+		{
+			end = text.size();
+		}
+		else
+		{
+			const size_t newline = text.find('\n', end);
+			end = newline == std::string_view::npos ? text.size() : newline + 1;
+		}
+		chunks.push_back(text.substr(begin, end - begin));
+		begin = end;
+	}
+	if (chunks.empty())
+	{
+		chunks.emplace_back();
+	}
+	return chunks;
+}
+
+void ScanDotChunk(std::string_view text, MachineKind kind, DotChunk& chunk)
+{
+	ForEachDotLine(text, [&](std::string_view line, size_t) {
+		const DotLine dotLine = ScanDotLine(line);
+		if (dotLine.kind == DotLine::Kind::State)
+		{
+			std::string_view state = dotLine.fromNode;
+			std::string_view output;
+			if (kind == MachineKind::Moore && !SplitDotLabel(dotLine.label, state, output))
+			{
+				state = dotLine.label;
+			}
+			chunk.declarations.push_back({chunk.nodes.Intern(dotLine.fromNode), chunk.states.Intern(state), kind == MachineKind::Moore ? chunk.outputs.Intern(output) : MachineTable::NO_ID});
+		}
+		else if (dotLine.kind == DotLine::Kind::Transition)
+		{
+			std::string_view input = dotLine.label;
+			std::string_view output;
+			if (kind == MachineKind::Mealy && !SplitDotLabel(dotLine.label, input, output))
+			{
+				chunk.failed = true;
+				return;
+			}
+			chunk.edges.push_back({chunk.nodes.Intern(dotLine.fromNode), chunk.nodes.Intern(dotLine.toNode), chunk.inputs.Intern(input), kind == MachineKind::Mealy ? chunk.outputs.Intern(output) : MachineTable::NO_ID, chunk.declarations.size()});
+		}
+	});
+}
+
+// Maps the ids of local to ids of global; a single chunk hands its names over as they are
+std::vector<Id> MergeNames(NameInterner& local, NameInterner& global, bool single)
+{
+	std::vector<Id> ids(local.GetSize());
+	if (single)
+	{
+		global = std::move(local);
+		std::iota(ids.begin(), ids.end(), Id{0});
+		return ids;
+	}
+	for (Id id = 0; id < ids.size(); ++id)
+	{
+		ids[id] = global.Intern(local.GetName(id));
+	}
+	return ids;
+}
+
+// Replays the chunks in file order, so that a node stands for its latest declaration and the first declared state
+// becomes the start state; returns false when an edge refers to a node that is not declared before it
+bool ResolveDotChunks(std::vector<DotChunk>& chunks, MachineKind kind, DotDefinition& definition)
+{
+	const bool single = chunks.size() == 1;
+	NameInterner nodes;
+	std::vector<Id> nodeStates;
+
+	for (auto& chunk : chunks)
+	{
+		const auto nodeIds = MergeNames(chunk.nodes, nodes, single);
+		const auto stateIds = MergeNames(chunk.states, definition.states, single);
+		const auto inputIds = MergeNames(chunk.inputs, definition.inputs, single);
+		const auto outputIds = MergeNames(chunk.outputs, definition.outputs, single);
+		nodeStates.resize(nodes.GetSize(), MachineTable::NO_ID);
+		definition.stateOutputs.resize(kind == MachineKind::Moore ? definition.states.GetSize() : 0, MachineTable::NO_ID);
+
+		size_t applied = 0;
+		const auto applyDeclarations = [&](size_t count) {
+			for (; applied < count; ++applied)
+			{
+				const auto& declaration = chunk.declarations[applied];
+				const Id state = stateIds[declaration.state];
+				nodeStates[nodeIds[declaration.node]] = state;
+				if (kind == MachineKind::Moore)
+				{
+					definition.stateOutputs[state] = outputIds[declaration.output];
+				}
+				if (definition.startState == MachineTable::NO_ID)
+				{
+					definition.startState = state;
+				}
+			}
+		};
+
+		definition.transitions.reserve(definition.transitions.size() + chunk.edges.size());
+		for (const auto& edge : chunk.edges)
+		{
+			applyDeclarations(edge.declarationsBefore);
+			const Id from = nodeStates[nodeIds[edge.fromNode]];
+			const Id to = nodeStates[nodeIds[edge.toNode]];
+			if (from == MachineTable::NO_ID || to == MachineTable::NO_ID)
+			{
+				return false;
+			}
+			definition.transitions.push_back({from, inputIds[edge.input], to, kind == MachineKind::Mealy ? outputIds[edge.output] : MachineTable::NO_ID});
+		}
+		applyDeclarations(chunk.declarations.size());
+	}
+	return true;
+}
+
+// Rescans text line by line and throws the error a sequential parse would report first
+[[noreturn]] void ThrowFirstDotError(std::string_view text, MachineKind kind)
+{
+	std::unordered_set<std::string_view> nodes;
+	ForEachDotLine(text, [&](std::string_view line, size_t lineNumber) {
+		const DotLine dotLine = ScanDotLine(line);
+		if (dotLine.kind == DotLine::Kind::State)
+		{
+			nodes.insert(dotLine.fromNode);
+		}
+		else if (dotLine.kind == DotLine::Kind::Transition)
+		{
+			std::string_view input;
+			std::string_view output;
+			if (kind == MachineKind::Mealy && !SplitDotLabel(dotLine.label, input, output))
+			{
+				throw std::runtime_error("Invalid transition label format at " + DescribeDotPosition(line, lineNumber, dotLine.label) + ": " + std::string(dotLine.label));
+			}
+			for (const auto node : {dotLine.fromNode, dotLine.toNode})
+			{
+				if (!nodes.contains(node))
+				{
+					throw std::out_of_range("Undeclared state " + std::string(node) + " at " + DescribeDotPosition(line, lineNumber, node));
+				}
+			}
+		}
+	});
+	throw std::runtime_error("Invalid DOT text");
+}
+
+void AppendOutput(MachineTable::RunResult& result, OutputMode mode, size_t position, Id output)
+{
+	const bool repeats = !result.outputs.empty() && result.outputs.back() == output;
+	switch (mode)
+	{
+	case OutputMode::Every:
+		result.outputs.push_back(output);
+		break;
+	case OutputMode::OnChange:
+		if (!repeats)
+		{
+			result.outputs.push_back(output);
+			result.positions.push_back(position);
+		}
+		break;
+	case OutputMode::RunLength:
+		if (repeats)
+		{
+			++result.counts.back();
+		}
+		else
+		{
+			result.outputs.push_back(output);
+			result.counts.push_back(1);
+		}
+		break;
+	}
+}
+} // namespace
+
+MachineTable::MachineTable(const MealyMachine& machine)
+	: m_kind(MachineKind::Mealy)
+{
+	const auto transitions = machine.GetTransitions();
+	const auto states = machine.GetStates();
+
+	std::vector<std::string> inputs;
+	std::vector<std::string> outputs;
+	for (const auto& transition : transitions)
+	{
+		inputs.push_back(transition.first.second);
+		outputs.push_back(transition.second.second);
+	}
+
+	m_stateNames.assign(states.begin(), states.end());
+	m_inputNames = ToSortedNames(inputs);
+	m_outputNames = ToSortedNames(outputs);
+	BuildIndexes();
+
+	m_inputCount = m_inputNames.size();
+	m_cells.assign(m_stateNames.size() * m_inputCount, {});
+	for (const auto& transition : transitions)
+	{
+		const Id from = m_stateIds.at(transition.first.first);
+		const Id input = m_inputIds.at(transition.first.second);
+		m_cells[static_cast<size_t>(from) * m_inputCount + input] = {m_stateIds.at(transition.second.first), m_outputIds.at(transition.second.second)};
+	}
+
+	m_startState = FindState(machine.GetStartState());
+}
+
+MachineTable::MachineTable(const MooreMachine& machine)
+	: m_kind(MachineKind::Moore)
+{
+	const auto transitions = machine.GetTransitions();
+	const auto states = machine.GetStates();
+	const auto stateOutputs = machine.GetOutputs();
+
+	std::vector<std::string> inputs;
+	for (const auto& transition : transitions)
+	{
+		inputs.push_back(transition.first.second);
+	}
+
+	std::vector<std::string> outputs;
+	for (const auto& [state, output] : stateOutputs)
+	{
+		outputs.push_back(output);
+	}
+
+	m_stateNames.assign(states.begin(), states.end());
+	m_inputNames = ToSortedNames(inputs);
+	m_outputNames = ToSortedNames(outputs);
+	BuildIndexes();
+
+	m_stateOutputs.assign(m_stateNames.size(), NO_ID);
+	for (const auto& [state, output] : stateOutputs)
+	{
+		if (const Id id = FindState(state); id != NO_ID)
+		{
+			m_stateOutputs[id] = m_outputIds.at(output);
+		}
+	}
+
+	m_inputCount = m_inputNames.size();
+	m_cells.assign(m_stateNames.size() * m_inputCount, {});
+	for (const auto& transition : transitions)
+	{
+		const Id from = m_stateIds.at(transition.first.first);
+		const Id input = m_inputIds.at(transition.first.second);
+		const Id to = m_stateIds.at(transition.second);
+		m_cells[static_cast<size_t>(from) * m_inputCount + input] = {to, m_stateOutputs[to]};
+	}
+
+	m_startState = FindState(machine.GetStartState());
+}
+
+MachineTable MachineTable::FromDotFile(const std::string& name, MachineKind kind, size_t chunkCount)
+{
+	const MappedFile file(name);
+	const std::string_view text = file.GetView();
+	if (chunkCount == 0)
+	{
+		chunkCount = GetChunkCount(text.size(), MIN_DOT_CHUNK_BYTES);
+	}
+
+	const auto pieces = SplitAtLines(text, chunkCount);
+	std::vector<DotChunk> chunks(pieces.size());
+	ForEachChunk(pieces.size(), pieces.size(), [&](size_t chunk, size_t, size_t) {
+		ScanDotChunk(pieces[chunk], kind, chunks[chunk]);
+	});
+
+	DotDefinition definition;
+	if (std::ranges::any_of(chunks, &DotChunk::failed) || !ResolveDotChunks(chunks, kind, definition))
+	{
+		ThrowFirstDotError(text, kind);
+	}
+	auto& [states, inputs, outputs, stateOutputs, transitions, startState] = definition;
+
+	MachineTable table;
+	table.m_kind = kind;
+
+	std::vector<Id> newStates;
+	std::vector<Id> newInputs;
+	std::vector<Id> newOutputs;
+	table.m_stateNames = states.TakeSorted(std::vector<bool>(states.GetSize(), true), newStates);
+	table.m_inputNames = inputs.TakeSorted(std::vector<bool>(inputs.GetSize(), true), newInputs);
+	table.m_inputCount = table.m_inputNames.size();
+
+	// Only outputs still referenced after later declarations and transitions overwrote earlier ones are kept
+	std::vector<bool> usedOutputs(outputs.GetSize(), false);
+	std::vector<DotTransition> cells(table.m_stateNames.size() * table.m_inputCount);
+	for (const auto& transition : transitions)
+	{
+		cells[static_cast<size_t>(newStates[transition.from]) * table.m_inputCount + newInputs[transition.input]] = transition;
+	}
+	if (kind == MachineKind::Moore)
+	{
+		for (const Id output : stateOutputs)
+		{
+			usedOutputs[output] = true;
+		}
+	}
+	else
+	{
+		for (const auto& cell : cells)
+		{
+			if (cell.output != NO_ID)
+			{
+				usedOutputs[cell.output] = true;
+			}
+		}
+	}
+	table.m_outputNames = outputs.TakeSorted(usedOutputs, newOutputs);
+
+	if (kind == MachineKind::Moore)
+	{
+		table.m_stateOutputs.assign(table.m_stateNames.size(), NO_ID);
+		for (Id state = 0; state < stateOutputs.size(); ++state)
+		{
+			table.m_stateOutputs[newStates[state]] = newOutputs[stateOutputs[state]];
+		}
+	}
+
+	table.m_cells.reserve(cells.size());
+	for (const auto& cell : cells)
+	{
+		if (cell.to == NO_ID)
+		{
+			table.m_cells.emplace_back();
+			continue;
+		}
+		const Id next = newStates[cell.to];
+		table.m_cells.push_back({next, kind == MachineKind::Moore ? table.m_stateOutputs[next] : newOutputs[cell.output]});
+	}
+
+	table.m_startState = startState == NO_ID ? NO_ID : newStates[startState];
+	table.BuildIndexes();
+	return table;
+}
+
+MachineKind MachineTable::GetKind() const
+{
+	return m_kind;
+}
+
+size_t MachineTable::GetStateCount() const
+{
+	return m_stateNames.size();
+}
+
+size_t MachineTable::GetInputCount() const
+{
+	return m_inputCount;
+}
+
+size_t MachineTable::GetOutputCount() const
+{
+	return m_outputNames.size();
+}
+
+MachineTable::Id MachineTable::GetStartState() const
+{
+	return m_startState;
+}
+
+std::string_view MachineTable::GetStateName(Id state) const
+{
+	return GetName(m_stateNames, state, "state");
+}
+
+std::string_view MachineTable::GetInputName(Id input) const
+{
+	return GetName(m_inputNames, input, "input");
+}
+
+std::string_view MachineTable::GetOutputName(Id output) const
+{
+	return GetName(m_outputNames, output, "output");
+}
+
+MachineTable::Id MachineTable::FindState(std::string_view name) const
+{
+	return Find(m_stateIds, name);
+}
+
+MachineTable::Id MachineTable::FindInput(std::string_view name) const
+{
+	return Find(m_inputIds, name);
+}
+
+MachineTable::Id MachineTable::FindOutput(std::string_view name) const
+{
+	return Find(m_outputIds, name);
+}
+
+std::vector<MachineTable::Id> MachineTable::EncodeInputs(std::span<const std::string> inputs) const
+{
+	std::vector<Id> ids;
+	ids.reserve(inputs.size());
+	for (const auto& input : inputs)
+	{
+		ids.push_back(FindInput(input));
+	}
+	return ids;
+}
+
+std::span<const MachineTable::Cell> MachineTable::GetCells() const
+{
+	return m_cells;
+}
+
+MachineTable::Id MachineTable::GetStateOutput(Id state) const
+{
+	return state < m_stateOutputs.size() ? m_stateOutputs[state] : NO_ID;
+}
+
+MachineTable MachineTable::WithStateOrder(std::span<const Id> order) const
+{
+	const size_t stateCount = GetStateCount();
+	if (order.size() != stateCount)
+	{
+		throw std::invalid_argument("State order must list every state exactly once");
+	}
+
+	std::vector<Id> newIds(stateCount, NO_ID);
+	for (size_t newId = 0; newId < stateCount; ++newId)
+	{
+		if (order[newId] >= stateCount || newIds[order[newId]] != NO_ID)
+		{
+			throw std::invalid_argument("State order must list every state exactly once");
+		}
+		newIds[order[newId]] = static_cast<Id>(newId);
+	}
+
+	MachineTable table;
+	table.m_kind = m_kind;
+	table.m_inputCount = m_inputCount;
+	table.m_startState = m_startState == NO_ID ? NO_ID : newIds[m_startState];
+	table.m_inputNames = m_inputNames;
+	table.m_outputNames = m_outputNames;
+	table.m_stateNames.reserve(stateCount);
+	table.m_cells.reserve(m_cells.size());
+	for (const Id state : order)
+	{
+		table.m_stateNames.push_back(m_stateNames[state]);
+		if (!m_stateOutputs.empty())
+		{
+			table.m_stateOutputs.push_back(m_stateOutputs[state]);
+		}
+		for (size_t input = 0; input < m_inputCount; ++input)
+		{
+			const Cell cell = m_cells[static_cast<size_t>(state) * m_inputCount + input];
+			table.m_cells.push_back({cell.next == NO_ID ? NO_ID : newIds[cell.next], cell.output});
+		}
+	}
+	table.BuildIndexes();
+	return table;
+}
+
+std::uint64_t MachineTable::GetFingerprint() const
+{
+	std::uint64_t hash = FNV_OFFSET_BASIS;
+	HashValue(hash, static_cast<std::uint64_t>(m_kind));
+	HashValue(hash, m_startState);
+	HashNames(hash, m_stateNames);
+	HashNames(hash, m_inputNames);
+	HashNames(hash, m_outputNames);
+	HashBytes(hash, m_cells.data(), m_cells.size() * sizeof(Cell));
+	HashBytes(hash, m_stateOutputs.data(), m_stateOutputs.size() * sizeof(Id));
+	return hash;
+}
+
+MachineTable::RunResult MachineTable::Run(std::span<const Id> inputs, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	RunResult result;
+	result.finalState = m_startState;
+	if (mode == OutputMode::Every)
+	{
+		result.outputs.reserve(inputs.size());
+		result.consumed = RunInto(inputs, result.finalState, [&result](Id output) { result.outputs.push_back(output); }, policy);
+		return result;
+	}
+
+	size_t emitted = 0;
+	result.consumed = RunInto(inputs, result.finalState, [&](Id output) { AppendOutput(result, mode, emitted++, output); }, policy);
+	return result;
+}
+
+MachineTable::RunResult MachineTable::Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	return Run(EncodeInputs(inputs), policy, mode);
+}
+
+MachineTable::NamedRunResult MachineTable::Decode(const RunResult& result) const
+{
+	NamedRunResult named;
+	named.outputs.reserve(result.outputs.size());
+	for (const Id output : result.outputs)
+	{
+		named.outputs.emplace_back(GetOutputName(output));
+	}
+	named.positions = result.positions;
+	named.counts = result.counts;
+	named.finalState = GetStateName(result.finalState);
+	named.consumed = result.consumed;
+	return named;
+}
+
+std::vector<MachineTable::RunResult> MachineTable::RunBatch(std::span<const std::span<const Id>> streams, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	std::vector<RunResult> results(streams.size());
+	if (streams.empty())
+	{
+		return results;
+	}
+	CheckState(m_startState);
+
+	struct Lane
+	{
+		size_t stream = 0;
+		size_t position = 0;
+		size_t emitted = 0;
+		Id state = NO_ID;
+		bool active = false;
+	};
+
+	const Cell* cells = m_cells.data();
+	const size_t inputCount = m_inputCount;
+	const auto prefetch = [&](const Lane& lane) {
+		const auto& inputs = streams[lane.stream];
+		if (lane.position < inputs.size() && inputs[lane.position] < inputCount)
+		{
+			PrefetchForRead(&cells[static_cast<size_t>(lane.state) * inputCount + inputs[lane.position]]);
+		}
+	};
+
+	std::array<Lane, BATCH_LANES> lanes;
+	size_t nextStream = 0;
+	size_t activeLanes = 0;
+	const auto assign = [&](Lane& lane) {
+		lane.active = nextStream < streams.size();
+		if (lane.active)
+		{
+			lane = {nextStream, 0, 0, m_startState, true};
+			if (mode == OutputMode::Every)
+			{
+				results[nextStream].outputs.reserve(streams[nextStream].size());
+			}
+			++nextStream;
+			++activeLanes;
+			prefetch(lane);
+		}
+	};
+	const auto retire = [&](Lane& lane) {
+		results[lane.stream].finalState = lane.state;
+		results[lane.stream].consumed = lane.position;
+		--activeLanes;
+		assign(lane);
+	};
+
+	for (auto& lane : lanes)
+	{
+		assign(lane);
+	}
+
+	while (activeLanes > 0)
+	{
+		for (auto& lane : lanes)
+		{
+			if (!lane.active)
+			{
+				continue;
+			}
+
+			const auto& inputs = streams[lane.stream];
+			if (lane.position == inputs.size())
+			{
+				retire(lane);
+				continue;
+			}
+
+			const Id input = inputs[lane.position];
+			const Cell cell = input < inputCount ? cells[static_cast<size_t>(lane.state) * inputCount + input] : Cell{};
+			if (cell.next != NO_ID)
+			{
+				lane.state = cell.next;
+				AppendOutput(results[lane.stream], mode, lane.emitted++, cell.output);
+			}
+			else if (policy == UndefinedTransitionPolicy::Throw)
+			{
+				ThrowUndefinedTransition(lane.state, input);
+			}
+			else if (policy == UndefinedTransitionPolicy::Stop)
+			{
+				retire(lane);
+				continue;
+			}
+
+			++lane.position;
+			prefetch(lane);
+		}
+	}
+
+	return results;
+}
+
+MachineTable::RunResult MachineTable::RunParallel(std::span<const Id> inputs, UndefinedTransitionPolicy policy, size_t chunkCount) const
+{
+	CheckState(m_startState);
+
+	if (chunkCount == 0)
+	{
+		chunkCount = GetChunkCount(inputs.size());
+	}
+	chunkCount = std::min(chunkCount, inputs.size());
+	if (chunkCount <= 1 || GetStateCount() > MAX_SPECULATIVE_STATES)
+	{
+		return Run(inputs, policy);
+	}
+
+	const size_t chunkSize = (inputs.size() + chunkCount - 1) / chunkCount;
+	// Rounding the size up may leave fewer non-empty chunks than asked for
+	chunkCount = (inputs.size() + chunkSize - 1) / chunkSize;
+	const auto getChunkBegin = [&](size_t chunk) {
+		return std::min(inputs.size(), chunk * chunkSize);
+	};
+	const auto getChunk = [&](size_t chunk) {
+		const size_t begin = getChunkBegin(chunk);
+		return inputs.subspan(begin, std::min(inputs.size(), begin + chunkSize) - begin);
+	};
+
+	// NO_ID as an end state means the chunk stops (or throws) before its end when started from that state
+	const auto stepOrHalt = [&](Id state, Id input) {
+		if (input < m_inputCount)
+		{
+			const Cell cell = m_cells[static_cast<size_t>(state) * m_inputCount + input];
+			if (cell.next != NO_ID)
+			{
+				return cell.next;
+			}
+		}
+		return policy == UndefinedTransitionPolicy::Stay ? state : NO_ID;
+	};
+
+	std::vector<std::vector<Id>> endStates(chunkCount);
+	std::vector<RunResult> chunkResults(chunkCount);
+
+	ForEachChunk(chunkCount, chunkCount, [&](size_t chunk, size_t, size_t) {
+		const auto chunkInputs = getChunk(chunk);
+		if (chunk == 0)
+		{
+			auto& result = chunkResults[0];
+			result.finalState = m_startState;
+			result.outputs.reserve(chunkInputs.size());
+			result.consumed = RunInto(chunkInputs, result.finalState, [&result](Id output) { result.outputs.push_back(output); }, policy);
+			return;
+		}
+
+		std::vector<Id> laneOfState(GetStateCount());
+		std::vector<Id> lanes(GetStateCount());
+		for (Id state = 0; state < lanes.size(); ++state)
+		{
+			laneOfState[state] = state;
+			lanes[state] = state;
+		}
+
+		std::vector<Id> mergedLane(GetStateCount() + 1);
+		for (size_t i = 0; i < chunkInputs.size(); ++i)
+		{
+			for (auto& lane : lanes)
+			{
+				if (lane != NO_ID)
+				{
+					lane = stepOrHalt(lane, chunkInputs[i]);
+				}
+			}
+
+			if ((i + 1) % SPECULATION_MERGE_INTERVAL == 0 && lanes.size() > 1)
+			{
+				std::ranges::fill(mergedLane, NO_ID);
+				std::vector<Id> uniqueLanes;
+				std::vector<Id> remap(lanes.size());
+				for (size_t lane = 0; lane < lanes.size(); ++lane)
+				{
+					const size_t slot = lanes[lane] == NO_ID ? GetStateCount() : lanes[lane];
+					if (mergedLane[slot] == NO_ID)
+					{
+						mergedLane[slot] = static_cast<Id>(uniqueLanes.size());
+						uniqueLanes.push_back(lanes[lane]);
+					}
+					remap[lane] = mergedLane[slot];
+				}
+				for (auto& lane : laneOfState)
+				{
+					lane = remap[lane];
+				}
+				lanes = std::move(uniqueLanes);
+			}
+		}
+
+		auto& chunkEndStates = endStates[chunk];
+		chunkEndStates.resize(GetStateCount());
+		for (size_t state = 0; state < chunkEndStates.size(); ++state)
+		{
+			chunkEndStates[state] = lanes[laneOfState[state]];
+		}
+	});
+
+	std::vector<Id> startStates(chunkCount, NO_ID);
+	startStates[0] = m_startState;
+	size_t lastChunk = 0;
+	if (chunkResults[0].consumed == getChunk(0).size())
+	{
+		Id state = chunkResults[0].finalState;
+		for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+		{
+			startStates[chunk] = state;
+			lastChunk = chunk;
+			state = endStates[chunk][state];
+			if (state == NO_ID)
+			{
+				break;
+			}
+		}
+	}
+
+	if (lastChunk > 0)
+	{
+		ForEachChunk(lastChunk, lastChunk, [&](size_t index, size_t, size_t) {
+			const size_t chunk = index + 1;
+			const auto chunkInputs = getChunk(chunk);
+			auto& result = chunkResults[chunk];
+			result.finalState = startStates[chunk];
+			result.outputs.reserve(chunkInputs.size());
+			result.consumed = RunInto(chunkInputs, result.finalState, [&result](Id output) { result.outputs.push_back(output); }, policy);
+		});
+	}
+
+	RunResult result;
+	size_t outputCount = 0;
+	for (size_t chunk = 0; chunk <= lastChunk; ++chunk)
+	{
+		outputCount += chunkResults[chunk].outputs.size();
+	}
+	result.outputs.reserve(outputCount);
+
+	for (size_t chunk = 0; chunk <= lastChunk; ++chunk)
+	{
+		const auto& chunkResult = chunkResults[chunk];
+		result.outputs.insert(result.outputs.end(), chunkResult.outputs.begin(), chunkResult.outputs.end());
+		result.finalState = chunkResult.finalState;
+		result.consumed = getChunkBegin(chunk) + chunkResult.consumed;
+	}
+
+	return result;
+}
+
+void MachineTable::ThrowUndefinedTransition(Id state, Id input) const
+{
+	const std::string inputName = input < m_inputCount ? m_inputNames[input] : "<unknown>";
+	throw std::runtime_error("Undefined transition from state " + m_stateNames[state] + " on input " + inputName);
+}
+
+void MachineTable::CheckState(Id state) const
+{
+	if (m_startState == NO_ID && state == NO_ID)
+	{
+		throw std::runtime_error("Machine has no start state");
+	}
+	if (state >= m_stateNames.size())
+	{
+		throw std::out_of_range("Unknown state id " + std::to_string(state));
+	}
+}
+
+void MachineTable::BuildIndexes()
+{
+	const auto buildIndex = [](const std::vector<std::string>& names, NameIndex& index) {
+		index.clear();
+		index.reserve(names.size());
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			index.emplace(names[i], static_cast<Id>(i));
+		}
+	};
+
+	buildIndex(m_stateNames, m_stateIds);
+	buildIndex(m_inputNames, m_inputIds);
+	buildIndex(m_outputNames, m_outputIds);
+}
@@ -0,0 +1,221 @@
+#include "MachineTable.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+using Id = MachineTable::Id;
+using Cell = MachineTable::Cell;
+
+constexpr std::array<char, 8> BINARY_MAGIC = {'F', 'A', 'B', 'I', 'N', '\0', '\0', '\0'};
+constexpr std::uint32_t BINARY_VERSION = 1;
+constexpr size_t BINARY_ALIGNMENT = 8;
+constexpr std::uint64_t CHECKSUM_OFFSET_BASIS = 14695981039346656037ull;
+constexpr std::uint64_t CHECKSUM_PRIME = 1099511628211ull;
+
+// The body follows the header in this order, every section padded to BINARY_ALIGNMENT:
+// cells (stateCount * inputCount), state outputs (stateCount for Moore, none for Mealy),
+// name offsets (stateCount + inputCount + outputCount + 1 offsets into the name bytes), name bytes
+struct BinaryHeader
+{
+	std::array<char, 8> magic = BINARY_MAGIC;
+	std::uint32_t version = BINARY_VERSION;
+	MachineKind kind = MachineKind::Mealy;
+	Id startState = MachineTable::NO_ID;
+	std::uint32_t reserved = 0;
+	std::uint64_t stateCount = 0;
+	std::uint64_t inputCount = 0;
+	std::uint64_t outputCount = 0;
+	std::uint64_t nameBytes = 0;
+	// FNV-1a over the 64-bit words of this header, taken with checksum = 0, and of the body
+	std::uint64_t checksum = 0;
+};
+
+static_assert(sizeof(BinaryHeader) == 64);
+static_assert(sizeof(Cell) == 8);
+
+size_t PadSize(size_t size)
+{
+	return (size + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+}
+
+void HashWords(std::uint64_t& hash, const char* data, size_t size)
+{
+	for (size_t i = 0; i < size; i += sizeof(std::uint64_t))
+	{
+		std::uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * CHECKSUM_PRIME;
+	}
+}
+
+std::uint64_t ComputeChecksum(BinaryHeader header, const char* body, size_t size)
+{
+	header.checksum = 0;
+	std::uint64_t hash = CHECKSUM_OFFSET_BASIS;
+	HashWords(hash, reinterpret_cast<const char*>(&header), sizeof(header));
+	HashWords(hash, body, size);
+	return hash;
+}
+
+void AppendBytes(std::string& body, const void* data, size_t size)
+{
+	body.append(static_cast<const char*>(data), size);
+	body.resize(PadSize(body.size()), '\0');
+}
+
+// Section sizes of a body, or false when the counts in the header cannot describe a file of fileSize bytes
+bool GetSectionSizes(const BinaryHeader& header, size_t fileSize, std::array<size_t, 4>& sizes)
+{
+	const size_t available = fileSize - sizeof(BinaryHeader);
+	const std::uint64_t nameCount = header.stateCount + header.inputCount + header.outputCount + 1;
+	if (header.stateCount > available || header.inputCount > available || header.outputCount > available
+		|| header.nameBytes > available || nameCount > available / sizeof(std::uint64_t)
+		|| (header.inputCount != 0 && header.stateCount > available / sizeof(Cell) / header.inputCount))
+	{
+		return false;
+	}
+	sizes = {
+		PadSize(header.stateCount * header.inputCount * sizeof(Cell)),
+		PadSize(header.kind == MachineKind::Moore ? header.stateCount * sizeof(Id) : 0),
+		nameCount * sizeof(std::uint64_t),
+		PadSize(header.nameBytes),
+	};
+	return sizes[0] + sizes[1] + sizes[2] + sizes[3] == available;
+}
+
+bool IsValidId(Id id, std::uint64_t count)
+{
+	return id == MachineTable::NO_ID || id < count;
+}
+} // namespace
+
+void MachineTable::SaveBinary(const std::string& name) const
+{
+	std::string names;
+	std::vector<std::uint64_t> offsets{0};
+	for (const auto* table : {&m_stateNames, &m_inputNames, &m_outputNames})
+	{
+		for (const auto& tableName : *table)
+		{
+			names += tableName;
+			offsets.push_back(names.size());
+		}
+	}
+
+	std::string body;
+	body.reserve(PadSize(m_cells.size() * sizeof(Cell)) + PadSize(m_stateOutputs.size() * sizeof(Id)) + offsets.size() * sizeof(std::uint64_t) + PadSize(names.size()));
+	AppendBytes(body, m_cells.data(), m_cells.size() * sizeof(Cell));
+	AppendBytes(body, m_stateOutputs.data(), m_stateOutputs.size() * sizeof(Id));
+	AppendBytes(body, offsets.data(), offsets.size() * sizeof(std::uint64_t));
+	AppendBytes(body, names.data(), names.size());
+
+	BinaryHeader header;
+	header.kind = m_kind;
+	header.startState = m_startState;
+	header.stateCount = m_stateNames.size();
+	header.inputCount = m_inputCount;
+	header.outputCount = m_outputNames.size();
+	header.nameBytes = names.size();
+	header.checksum = ComputeChecksum(header, body.data(), body.size());
+
+	std::ofstream file(name, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Cannot open file: " + name);
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(body.data(), static_cast<std::streamsize>(body.size()));
+	if (!file)
+	{
+		throw std::runtime_error("Cannot write file: " + name);
+	}
+}
+
+MachineTable MachineTable::LoadBinary(const std::string& name)
+{
+	const MappedFile file(name);
+	const auto invalid = [&name] {
+		return std::runtime_error("Invalid machine file: " + name);
+	};
+
+	BinaryHeader header;
+	std::array<size_t, 4> sizes{};
+	if (file.GetSize() < sizeof(BinaryHeader))
+	{
+		throw invalid();
+	}
+	std::memcpy(&header, file.GetData(), sizeof(BinaryHeader));
+	if (header.magic != BINARY_MAGIC || header.version != BINARY_VERSION || header.reserved != 0
+		|| (header.kind != MachineKind::Mealy && header.kind != MachineKind::Moore)
+		|| !GetSectionSizes(header, file.GetSize(), sizes))
+	{
+		throw invalid();
+	}
+
+	const char* body = file.GetData() + sizeof(BinaryHeader);
+	if (ComputeChecksum(header, body, file.GetSize() - sizeof(BinaryHeader)) != header.checksum)
+	{
+		throw std::runtime_error("Checksum mismatch in machine file: " + name);
+	}
+
+	// Every section starts at a multiple of BINARY_ALIGNMENT from the page-aligned mapping, so it is copied out as is
+	const auto* cells = reinterpret_cast<const Cell*>(body);
+	const auto* stateOutputs = reinterpret_cast<const Id*>(body + sizes[0]);
+	const auto* offsets = reinterpret_cast<const std::uint64_t*>(body + sizes[0] + sizes[1]);
+	const char* names = body + sizes[0] + sizes[1] + sizes[2];
+
+	MachineTable table;
+	table.m_kind = header.kind;
+	table.m_inputCount = header.inputCount;
+	table.m_startState = header.startState;
+	if (!IsValidId(header.startState, header.stateCount))
+	{
+		throw invalid();
+	}
+
+	table.m_stateOutputs.assign(stateOutputs, stateOutputs + (header.kind == MachineKind::Moore ? header.stateCount : 0));
+	for (const Id output : table.m_stateOutputs)
+	{
+		if (!IsValidId(output, header.outputCount))
+		{
+			throw invalid();
+		}
+	}
+
+	table.m_cells.assign(cells, cells + header.stateCount * header.inputCount);
+	for (const Cell cell : table.m_cells)
+	{
+		if (!IsValidId(cell.next, header.stateCount) || !IsValidId(cell.output, header.outputCount))
+		{
+			throw invalid();
+		}
+	}
+
+	size_t nameIndex = 0;
+	for (auto [target, count] : {std::pair{&table.m_stateNames, header.stateCount}, std::pair{&table.m_inputNames, header.inputCount}, std::pair{&table.m_outputNames, header.outputCount}})
+	{
+		target->reserve(count);
+		for (std::uint64_t i = 0; i < count; ++i, ++nameIndex)
+		{
+			const std::uint64_t begin = offsets[nameIndex];
+			const std::uint64_t end = offsets[nameIndex + 1];
+			if (begin > end || end > header.nameBytes)
+			{
+				throw invalid();
+			}
+			target->emplace_back(names + begin, end - begin);
+		}
+	}
+
+	table.BuildIndexes();
+	if (table.m_stateIds.size() != header.stateCount || table.m_inputIds.size() != header.inputCount || table.m_outputIds.size() != header.outputCount)
+	{
+		throw invalid();
+	}
+	return table;
+}
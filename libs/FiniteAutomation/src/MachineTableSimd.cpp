@@ -0,0 +1,168 @@
+#include "MachineTable.h"
+
+#include <stdexcept>
+
+// FINITE_AUTOMATION_AVX512 / FINITE_AUTOMATION_AVX2 select a kernel. Only the kernel is compiled for that
+// instruction set, through a target attribute; the rest of the file stays baseline code, so the CPU check and the
+// scalar path run on any x86-64 CPU
+#if defined(FINITE_AUTOMATION_AVX512) || defined(FINITE_AUTOMATION_AVX2)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace
+{
+using Id = MachineTable::Id;
+using Cell = MachineTable::Cell;
+
+static_assert(sizeof(Cell) == 2 * sizeof(Id));
+
+constexpr size_t MAX_GATHER_CELLS = size_t{1} << 30;
+
+struct LaneBlock
+{
+	const Cell* cells;
+	size_t inputCount;
+};
+
+void StepScalar(const LaneBlock& block, Id* states, const Id* inputs, Id* outputs, size_t first, size_t last)
+{
+	for (size_t instance = first; instance < last; ++instance)
+	{
+		const Id input = inputs[instance];
+		const Cell cell = input < block.inputCount ? block.cells[static_cast<size_t>(states[instance]) * block.inputCount + input] : Cell{};
+		if (cell.next != MachineTable::NO_ID)
+		{
+			states[instance] = cell.next;
+		}
+		outputs[instance] = cell.output;
+	}
+}
+
+#if defined(FINITE_AUTOMATION_AVX512)
+constexpr size_t SIMD_LANES = 16;
+
+// Steps instances [0, n) in blocks of SIMD_LANES and returns n, the first instance left to the scalar path
+SIMD_TARGET("avx512f") size_t StepSimd(const LaneBlock& block, Id* states, const Id* inputs, Id* outputs, size_t instanceCount)
+{
+	const auto* base = reinterpret_cast<const int*>(block.cells);
+	const __m512i noId = _mm512_set1_epi32(-1);
+	const __m512i inputCount = _mm512_set1_epi32(static_cast<int>(block.inputCount));
+	const __m512i lastInput = _mm512_set1_epi32(static_cast<int>(block.inputCount - 1));
+
+	size_t first = 0;
+	for (; first + SIMD_LANES <= instanceCount; first += SIMD_LANES)
+	{
+		const __m512i state = _mm512_loadu_si512(states + first);
+		const __m512i input = _mm512_loadu_si512(inputs + first);
+		const __mmask16 valid = _mm512_cmple_epu32_mask(input, lastInput);
+		const __m512i index = _mm512_slli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(state, inputCount), input), 1);
+
+		const __m512i next = _mm512_mask_i32gather_epi32(noId, valid, index, base, 4);
+		const __m512i output = _mm512_mask_i32gather_epi32(noId, valid, index, base + 1, 4);
+
+		_mm512_storeu_si512(states + first, _mm512_mask_mov_epi32(state, _mm512_cmpneq_epi32_mask(next, noId), next));
+		_mm512_storeu_si512(outputs + first, output);
+	}
+	return first;
+}
+#elif defined(FINITE_AUTOMATION_AVX2)
+constexpr size_t SIMD_LANES = 8;
+
+// Steps instances [0, n) in blocks of SIMD_LANES and returns n, the first instance left to the scalar path
+SIMD_TARGET("avx2") size_t StepSimd(const LaneBlock& block, Id* states, const Id* inputs, Id* outputs, size_t instanceCount)
+{
+	const auto* base = reinterpret_cast<const int*>(block.cells);
+	const __m256i noId = _mm256_set1_epi32(-1);
+	const __m256i inputCount = _mm256_set1_epi32(static_cast<int>(block.inputCount));
+	const __m256i lastInput = _mm256_set1_epi32(static_cast<int>(block.inputCount - 1));
+
+	size_t first = 0;
+	for (; first + SIMD_LANES <= instanceCount; first += SIMD_LANES)
+	{
+		const __m256i state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + first));
+		const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs + first));
+		const __m256i valid = _mm256_cmpeq_epi32(_mm256_min_epu32(input, lastInput), input);
+		const __m256i index = _mm256_slli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(state, inputCount), input), 1);
+
+		const __m256i next = _mm256_mask_i32gather_epi32(noId, base, index, valid, 4);
+		const __m256i output = _mm256_mask_i32gather_epi32(noId, base + 1, index, valid, 4);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(states + first), _mm256_blendv_epi8(next, state, _mm256_cmpeq_epi32(next, noId)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(outputs + first), output);
+	}
+	return first;
+}
+#else
+constexpr size_t SIMD_LANES = 0;
+
+size_t StepSimd(const LaneBlock&, Id*, const Id*, Id*, size_t)
+{
+	return 0;
+}
+#endif
+
+// The kernel is built for the instruction set chosen at build time, which the running CPU may lack
+bool CpuSupportsSimd()
+{
+#if (defined(FINITE_AUTOMATION_AVX512) || defined(FINITE_AUTOMATION_AVX2)) && (defined(__GNUC__) || defined(__clang__))
+#if defined(FINITE_AUTOMATION_AVX512)
+	return __builtin_cpu_supports("avx512f");
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+#elif (defined(FINITE_AUTOMATION_AVX512) || defined(FINITE_AUTOMATION_AVX2)) && defined(_MSC_VER)
+	constexpr unsigned long long AVX_STATE = 0x6;
+	constexpr unsigned long long AVX512_STATE = 0xE6;
+	int info[4] = {};
+	__cpuid(info, 1);
+	const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & AVX_STATE) == AVX_STATE;
+	__cpuidex(info, 7, 0);
+#if defined(FINITE_AUTOMATION_AVX512)
+	return osSavesYmm && (_xgetbv(0) & AVX512_STATE) == AVX512_STATE && (info[1] & (1 << 16)) != 0;
+#else
+	return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#endif
+#else
+	return false;
+#endif
+}
+} // namespace
+
+void MachineTable::StepInstances(std::span<Id> states, std::span<const Id> inputs, std::span<Id> outputs) const
+{
+	if (states.empty())
+	{
+		return;
+	}
+	if (inputs.size() % states.size() != 0 || outputs.size() < inputs.size())
+	{
+		throw std::invalid_argument("Inputs and outputs must hold the same number of steps for every instance");
+	}
+	for (const Id state : states)
+	{
+		CheckState(state);
+	}
+
+	static const bool cpuSupportsSimd = CpuSupportsSimd();
+	const LaneBlock block{m_cells.data(), m_inputCount};
+	const size_t instanceCount = states.size();
+	const bool useSimd = SIMD_LANES != 0 && cpuSupportsSimd && m_inputCount != 0 && m_cells.size() < MAX_GATHER_CELLS;
+
+	for (size_t offset = 0; offset < inputs.size(); offset += instanceCount)
+	{
+		const Id* stepInputs = inputs.data() + offset;
+		Id* stepOutputs = outputs.data() + offset;
+
+		const size_t first = useSimd ? StepSimd(block, states.data(), stepInputs, stepOutputs, instanceCount) : 0;
+		StepScalar(block, states.data(), stepInputs, stepOutputs, first, instanceCount);
+	}
+}
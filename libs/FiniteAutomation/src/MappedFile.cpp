@@ -0,0 +1,150 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& name)
+{
+#ifdef _WIN32
+	m_file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = nullptr;
+		throw std::runtime_error("Cannot open file: " + name);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size))
+	{
+		Close();
+		throw std::runtime_error("Cannot read file size: " + name);
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = m_mapping != nullptr ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		Close();
+		throw std::runtime_error("Cannot map file: " + name);
+	}
+	m_data = static_cast<const char*>(view);
+#else
+	const int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot open file: " + name);
+	}
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("Cannot read file size: " + name);
+	}
+	m_size = static_cast<size_t>(info.st_size);
+	if (m_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		m_size = 0;
+		throw std::runtime_error("Cannot map file: " + name);
+	}
+	madvise(view, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const char*>(view);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data(std::exchange(other.m_data, nullptr))
+	, m_size(std::exchange(other.m_size, 0))
+#ifdef _WIN32
+	, m_file(std::exchange(other.m_file, nullptr))
+	, m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+		m_file = std::exchange(other.m_file, nullptr);
+		m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+const char* MappedFile::GetData() const
+{
+	return m_data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return m_size;
+}
+
+std::string_view MappedFile::GetView() const
+{
+	return m_data == nullptr ? std::string_view() : std::string_view(m_data, m_size);
+}
+
+void MappedFile::Close() noexcept
+{
+#ifdef _WIN32
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file != nullptr)
+	{
+		CloseHandle(m_file);
+	}
+	m_file = nullptr;
+	m_mapping = nullptr;
+#else
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
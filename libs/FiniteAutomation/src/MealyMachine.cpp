@@ -1,117 +1,154 @@
 ﻿#include "MealyMachine.h"
 #include "MooreMachine.h"
+#include "BufferedWriter.h"
+#include "CppSourceWriter.h"
+#include "DotScanner.h"
+#include "MappedFile.h"
+#include "ParallelUtils.h"
 
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <map>
-#include <regex>
+#include <queue>
 #include <sstream>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 namespace
 {
-const std::regex STATE_REGEX(R"lit(^\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
-const std::regex TRANSITION_REGEX(R"lit(^\s*(\w+)\s*->\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
-const std::regex LABEL_REGEX("^([^/]+)/(.+)$");
-
 constexpr size_t STATE_WIDTH = 12;
 constexpr size_t CELL_WIDTH = 12;
 
 using State = MealyMachine::State;
-using TransitionLabel = std::pair<std::string, std::string>;
 using Partition = std::vector<std::set<State>>;
 
-TransitionLabel ParseLabel(const std::string& label)
+void ParseDot(MealyMachine& machine, std::string_view text)
 {
-	std::smatch match;
-	if (!std::regex_match(label, match, LABEL_REGEX))
-	{
-		throw std::runtime_error("Invalid transition label format: " + label);
-	}
+	std::unordered_set<std::string_view> nodes;
+	bool hasStartState = false;
 
-	return {match[1], match[2]};
+	ForEachDotLine(text, [&](std::string_view line, size_t lineNumber) {
+		const DotLine dotLine = ScanDotLine(line);
+		if (dotLine.kind == DotLine::Kind::State)
+		{
+			nodes.insert(dotLine.fromNode);
+			const State state(dotLine.fromNode);
+			machine.AddState(state);
+			if (!hasStartState)
+			{
+				machine.SetStartState(state);
+				hasStartState = true;
+			}
+		}
+		else if (dotLine.kind == DotLine::Kind::Transition)
+		{
+			std::string_view input;
+			std::string_view output;
+			if (!SplitDotLabel(dotLine.label, input, output))
+			{
+				throw std::runtime_error("Invalid transition label format at " + DescribeDotPosition(line, lineNumber, dotLine.label) + ": " + std::string(dotLine.label));
+			}
+
+			const auto findState = [&](std::string_view node) {
+				if (!nodes.contains(node))
+				{
+					throw std::out_of_range("Undeclared state " + std::string(node) + " at " + DescribeDotPosition(line, lineNumber, node));
+				}
+				return State(node);
+			};
+			machine.SetTransition(findState(dotLine.fromNode), std::string(input), findState(dotLine.toNode), std::string(output));
+		}
+	});
 }
 
-bool ParseState(const std::string& line, MealyMachine& machine, std::map<std::string, State>& stateMap)
+int FindGroupIndex(const Partition& partition, const State& state)
 {
-	std::smatch match;
-	if (!std::regex_match(line, match, STATE_REGEX))
+	for (size_t i = 0; i < partition.size(); ++i)
 	{
-		return false;
+		if (partition[i].contains(state))
+		{
+			return static_cast<int>(i);
+		}
 	}
 
-	const std::string stateName = match[1];
-	stateMap[stateName] = stateName;
-	machine.AddState(stateName);
+	return -1;
+}
+
+void ConvertFull(const MooreMachine& mooreMachine, MealyMachine& mealyMachine)
+{
+	const auto mooreTransitions = mooreMachine.GetTransitions();
+	const auto mooreOutputs = mooreMachine.GetOutputs();
 
-	if (machine.GetStates().size() == 1)
+	for (const auto& transition : mooreTransitions)
 	{
-		machine.SetStartState(stateName);
-	}
+		const State& fromState = transition.first.first;
+		const std::string& input = transition.first.second;
+		const State& toState = transition.second;
+		const std::string& output = mooreOutputs.at(toState);
 
-	return true;
+		mealyMachine.SetTransition(fromState, input, toState, output);
+	}
 }
 
-bool ParseTransition(const std::string& line, MealyMachine& machine, std::map<std::string, State>& stateMap)
+void ConvertReachable(const MooreMachine& mooreMachine, MealyMachine& mealyMachine)
 {
-	std::smatch match;
-	if (!std::regex_match(line, match, TRANSITION_REGEX))
+	const State& startState = mooreMachine.GetStartState();
+	if (!mooreMachine.GetStates().contains(startState))
 	{
-		return false;
+		return;
 	}
 
-	const std::string srcStateName = match[1];
-	const std::string dstStateName = match[2];
-	const std::string label = match[3];
-
-	auto [input, output] = ParseLabel(label);
-
-	const State& srcState = stateMap.at(srcStateName);
-	const State& dstState = stateMap.at(dstStateName);
-
-	machine.SetTransition(srcState, input, dstState, output);
+	const auto mooreTransitions = mooreMachine.GetTransitions();
+	const auto mooreOutputs = mooreMachine.GetOutputs();
 
-	return true;
-}
+	mealyMachine.AddState(startState);
 
-void ParseDot(MealyMachine& machine, std::istream& input)
-{
-	std::map<std::string, MealyMachine::State> stateMap;
-	std::string line;
+	std::set<State> visited = {startState};
+	std::queue<State> worklist;
+	worklist.push(startState);
 
-	while (std::getline(input, line))
+	while (!worklist.empty())
 	{
-		if (line.empty())
-		{
-			continue;
-		}
+		const State fromState = worklist.front();
+		worklist.pop();
 
-		if (ParseState(line, machine, stateMap))
+		for (auto it = mooreTransitions.lower_bound({fromState, ""}); it != mooreTransitions.end() && it->first.first == fromState; ++it)
 		{
-			continue;
-		}
+			const std::string& input = it->first.second;
+			const State& toState = it->second;
 
-		if (ParseTransition(line, machine, stateMap))
-		{
-			continue;
+			if (visited.insert(toState).second)
+			{
+				worklist.push(toState);
+			}
+
+			mealyMachine.SetTransition(fromState, input, toState, mooreOutputs.at(toState));
 		}
 	}
 }
 
-int FindGroupIndex(const Partition& partition, const State& state)
+MealyMachine::MealyTransitions ConvertParallel(const MooreMachine::MooreTransitions& mooreTransitions, const MooreMachine::MooreOutputs& mooreOutputs)
 {
-	for (size_t i = 0; i < partition.size(); ++i)
+	// The Moore map is already sorted by (state, input), the key of the Mealy map, so every chunk of it is a sorted run
+	const auto transitions = GatherPointers(mooreTransitions);
+	return BuildSortedContainer<MealyMachine::MealyTransitions>(transitions.size(), [&](size_t i) {
+		const auto& [key, toState] = *transitions[i];
+		return std::make_pair(key, std::make_pair(toState, mooreOutputs.at(toState)));
+	});
+}
+
+std::string MakePairName(const State& first, const State& second, const std::set<State>& usedNames)
+{
+	const std::string name = first + "_" + second;
+	std::string uniqueName = name;
+	for (size_t suffix = 2; usedNames.contains(uniqueName); ++suffix)
 	{
-		if (partition[i].contains(state))
-		{
-			return static_cast<int>(i);
-		}
+		uniqueName = name + "_" + std::to_string(suffix);
 	}
-
-	return -1;
+	return uniqueName;
 }
 } // namespace
 
@@ -121,34 +158,38 @@ MealyMachine::MealyMachine(State initState)
 }
 
 MealyMachine::MealyMachine(const MooreMachine& mooreMachine)
+	: MealyMachine(mooreMachine, ConversionMode::Full)
 {
-	m_states = mooreMachine.GetStates();
-	m_startState = mooreMachine.GetStartState();
-
-	const auto mooreTransitions = mooreMachine.GetTransitions();
-	const auto mooreOutputs = mooreMachine.GetOutputs();
+}
 
-	for (const auto& transition : mooreTransitions)
+MealyMachine::MealyMachine(const MooreMachine& mooreMachine, ConversionMode mode)
+	: m_startState(mooreMachine.GetStartState())
+{
+	switch (mode)
 	{
-		const State& fromState = transition.first.first;
-		const std::string& input = transition.first.second;
-		const State& toState = transition.second;
-		const std::string& output = mooreOutputs.at(toState);
-
-		SetTransition(fromState, input, toState, output);
+	case ConversionMode::Full:
+		m_states = mooreMachine.GetStates();
+		ConvertFull(mooreMachine, *this);
+		break;
+	case ConversionMode::ReachableOnly:
+		ConvertReachable(mooreMachine, *this);
+		break;
+	case ConversionMode::Parallel:
+	{
+		const auto states = GatherPointers(mooreMachine.m_states);
+		m_states = BuildSortedContainer<std::set<State>>(states.size(), [&](size_t i) { return *states[i]; });
+		m_transitions = ConvertParallel(mooreMachine.m_transitions, mooreMachine.m_outputs);
+		break;
+	}
 	}
 }
 
 MealyMachine MealyMachine::FromDotFile(const std::string& name)
 {
-	std::ifstream file(name);
-	if (!file.is_open())
-	{
-		throw std::runtime_error("Cannot open file: " + name);
-	}
+	const MappedFile file(name);
 
 	MealyMachine machine;
-	ParseDot(machine, file);
+	ParseDot(machine, file.GetView());
 
 	return machine;
 }
@@ -156,28 +197,49 @@ MealyMachine MealyMachine::FromDotFile(const std::string& name)
 std::string MealyMachine::ToDotString() const
 {
 	std::ostringstream oss;
-	oss << "digraph mealyMachine {" << std::endl;
+	WriteDot(oss);
+	return oss.str();
+}
+
+void MealyMachine::WriteDot(std::ostream& output) const
+{
+	BufferedWriter writer(output);
+	writer << "digraph mealyMachine {\n";
 
 	for (const auto& state : m_states)
 	{
-		oss << state << " [label = \"" << state << "\"]" << std::endl;
+		writer << state << " [label = \"" << state << "\"]\n";
 	}
-	oss << std::endl;
+	writer << '\n';
 
-	std::vector<std::tuple<State, State, std::string, std::string>> sortedTransitions;
-	for (const auto& trans : m_transitions)
+	// The map already groups transitions by source state, so only the transitions of one state are ordered by
+	// (target, input) here
+	std::vector<const MealyTransitions::value_type*> group;
+	for (auto it = m_transitions.begin(); it != m_transitions.end();)
 	{
-		sortedTransitions.emplace_back(trans.first.first, trans.second.first, trans.first.second, trans.second.second);
-	}
-	std::ranges::sort(sortedTransitions);
+		group.clear();
+		const State& from = it->first.first;
+		for (; it != m_transitions.end() && it->first.first == from; ++it)
+		{
+			group.push_back(&*it);
+		}
+		std::ranges::sort(group, [](const auto* left, const auto* right) {
+			return std::tie(left->second.first, left->first.second) < std::tie(right->second.first, right->first.second);
+		});
 
-	for (const auto& transition : sortedTransitions)
-	{
-		oss << std::get<0>(transition) << " -> " << std::get<1>(transition) << " [label = \"" << std::get<2>(transition) << "/" << std::get<3>(transition) << "\"]" << std::endl;
+		for (const auto* transition : group)
+		{
+			writer << from << " -> " << transition->second.first << " [label = \"" << transition->first.second << "/" << transition->second.second << "\"]\n";
+		}
 	}
 
-	oss << std::endl;
-	return oss.str();
+	writer << '\n';
+	writer.Flush();
+}
+
+std::string MealyMachine::ToCppSource(const std::string& name) const
+{
+	return WriteCppSource(MachineTable(*this), name);
 }
 
 std::string MealyMachine::Print() const
@@ -240,6 +302,54 @@ std::string MealyMachine::Print() const
 	return oss.str();
 }
 
+MealyMachine MealyMachine::Compose(const MealyMachine& first, const MealyMachine& second, bool minimize)
+{
+	if (!first.m_states.contains(first.m_startState) || !second.m_states.contains(second.m_startState))
+	{
+		return {};
+	}
+
+	using StatePair = std::pair<State, State>;
+	std::map<StatePair, State> pairNames;
+	std::queue<StatePair> worklist;
+	MealyMachine composed;
+
+	const auto getName = [&](const StatePair& pair) {
+		const auto [it, inserted] = pairNames.try_emplace(pair);
+		if (inserted)
+		{
+			it->second = MakePairName(pair.first, pair.second, composed.m_states);
+			composed.AddState(it->second);
+			worklist.push(pair);
+		}
+		return it->second;
+	};
+
+	composed.SetStartState(getName({first.m_startState, second.m_startState}));
+
+	while (!worklist.empty())
+	{
+		const StatePair pair = worklist.front();
+		worklist.pop();
+		const State fromName = pairNames.at(pair);
+
+		for (auto it = first.m_transitions.lower_bound({pair.first, ""}); it != first.m_transitions.end() && it->first.first == pair.first; ++it)
+		{
+			const auto& [firstTarget, intermediate] = it->second;
+			const auto secondIt = second.m_transitions.find({pair.second, intermediate});
+			if (secondIt == second.m_transitions.end())
+			{
+				continue;
+			}
+
+			const auto& [secondTarget, output] = secondIt->second;
+			composed.SetTransition(fromName, it->first.second, getName({firstTarget, secondTarget}), output);
+		}
+	}
+
+	return minimize ? composed.Minimize() : composed;
+}
+
 MealyMachine MealyMachine::Minimize() const
 {
 	if (m_states.empty())
@@ -359,6 +469,12 @@ MealyMachine MealyMachine::Minimize() const
 	return minimizedMachine;
 }
 
+MachineTable::NamedRunResult MealyMachine::Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	const MachineTable table(*this);
+	return table.Decode(table.Run(inputs, policy, mode));
+}
+
 std::set<State> MealyMachine::GetStates() const
 {
 	return m_states;
@@ -1,22 +1,24 @@
 ﻿#include "MooreMachine.h"
 #include "MealyMachine.h"
+#include "BufferedWriter.h"
+#include "CppSourceWriter.h"
+#include "DotScanner.h"
+#include "MappedFile.h"
+#include "ParallelUtils.h"
 
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <map>
-#include <regex>
+#include <queue>
 #include <sstream>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace
 {
-const std::regex STATE_REGEX(R"lit(^\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
-const std::regex STATE_LABEL_REGEX("^([^/]+)/(.+)$");
-const std::regex TRANSITION_REGEX(R"lit(^\s*(\w+)\s*->\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
-
 constexpr size_t STATE_WIDTH = 12;
 constexpr size_t CELL_WIDTH = 12;
 
@@ -37,80 +39,43 @@ std::string GetBaseStateName(const std::string& stateName, const std::set<std::s
 	return stateName;
 }
 
-bool ParseMooreState(const std::string& line, MooreMachine& machine, std::map<std::string, State>& stateMap)
+void ParseDotMoore(MooreMachine& machine, std::string_view text)
 {
-	std::smatch match;
-	if (!std::regex_match(line, match, STATE_REGEX))
-	{
-		return false;
-	}
-
-	const std::string stateName = match[1];
-	const std::string stateLabel = match[2];
-
-	std::smatch labelMatch;
-	if (std::regex_match(stateLabel, labelMatch, STATE_LABEL_REGEX))
-	{
-		const std::string nameInLabel = labelMatch[1];
-		const std::string output = labelMatch[2];
-		stateMap[stateName] = nameInLabel;
-		machine.AddState(nameInLabel, output);
-	}
-	else
-	{
-		stateMap[stateName] = stateLabel;
-		machine.AddState(stateLabel, "");
-	}
-
-	if (machine.GetStates().size() == 1)
-	{
-		machine.SetStartState(stateMap.at(stateName));
-	}
-
-	return true;
-}
-
-bool ParseMooreTransition(const std::string& line, MooreMachine& machine, const std::map<std::string, State>& stateMap)
-{
-	std::smatch match;
-	if (!std::regex_match(line, match, TRANSITION_REGEX))
-	{
-		return false;
-	}
-
-	const std::string srcStateName = match[1];
-	const std::string dstStateName = match[2];
-	const std::string input = match[3];
+	std::unordered_map<std::string_view, State> stateMap;
+	bool hasStartState = false;
 
-	const State& srcState = stateMap.at(srcStateName);
-	const State& dstState = stateMap.at(dstStateName);
-
-	machine.SetTransition(srcState, input, dstState);
-	return true;
-}
-
-void ParseDotMoore(MooreMachine& machine, std::istream& input)
-{
-	std::map<std::string, State> stateMap;
-	std::string line;
-
-	while (std::getline(input, line))
-	{
-		if (line.empty())
-		{
-			continue;
-		}
-
-		if (ParseMooreState(line, machine, stateMap))
+	ForEachDotLine(text, [&](std::string_view line, size_t lineNumber) {
+		const DotLine dotLine = ScanDotLine(line);
+		if (dotLine.kind == DotLine::Kind::State)
 		{
-			continue;
+			std::string_view name;
+			std::string_view output;
+			if (!SplitDotLabel(dotLine.label, name, output))
+			{
+				name = dotLine.label;
+				output = {};
+			}
+			const State& state = stateMap[dotLine.fromNode] = State(name);
+			machine.AddState(state, std::string(output));
+			if (!hasStartState)
+			{
+				machine.SetStartState(state);
+				hasStartState = true;
+			}
 		}
-
-		if (ParseMooreTransition(line, machine, stateMap))
+		else if (dotLine.kind == DotLine::Kind::Transition)
 		{
-			continue;
+			const auto findState = [&](std::string_view node) -> const State& {
+				const auto it = stateMap.find(node);
+				if (it == stateMap.end())
+				{
+					throw std::out_of_range("Undeclared state " + std::string(node) + " at " + DescribeDotPosition(line, lineNumber, node));
+				}
+				return it->second;
+			};
+			machine.SetTransition(findState(dotLine.fromNode), std::string(dotLine.label), findState(dotLine.toNode));
 		}
-	}
+	});
 }
 
 int FindGroupIndex(const Partition& partition, const MooreState& state)
@@ -124,14 +89,8 @@ int FindGroupIndex(const Partition& partition, const MooreState& state)
 	}
 	return -1;
 }
-} // namespace
-
-MooreMachine::MooreMachine(State initState)
-	: m_startState(std::move(initState))
-{
-}
 
-MooreMachine::MooreMachine(const MealyMachine& mealyMachine)
+void ConvertFull(const MealyMachine& mealyMachine, MooreMachine& mooreMachine)
 {
 	if (mealyMachine.GetStates().empty())
 	{
@@ -158,13 +117,13 @@ MooreMachine::MooreMachine(const MealyMachine& mealyMachine)
 			State newMooreStateName = baseName + "_" + output;
 
 			mooreStateMap[key] = newMooreStateName;
-			this->AddState(newMooreStateName, output);
+			mooreMachine.AddState(newMooreStateName, output);
 		}
 	}
 
 	const State& mealyStart = mealyMachine.GetStartState();
-	this->AddState(mealyStart, "(L)");
-	this->SetStartState(mealyStart);
+	mooreMachine.AddState(mealyStart, "(L)");
+	mooreMachine.SetStartState(mealyStart);
 
 	for (const auto& mealyTrans : mealyMachine.GetTransitions())
 	{
@@ -180,27 +139,242 @@ MooreMachine::MooreMachine(const MealyMachine& mealyMachine)
 			if (GetBaseStateName(pair.first.first, allOutputs) == GetBaseStateName(fromStateMealy, allOutputs))
 			{
 				const State& fromStateMoore = pair.second;
-				this->SetTransition(fromStateMoore, input, toStateMoore);
+				mooreMachine.SetTransition(fromStateMoore, input, toStateMoore);
 			}
 		}
 
 		if (GetBaseStateName(fromStateMealy, allOutputs) == GetBaseStateName(mealyStart, allOutputs))
 		{
-			this->SetTransition(mealyStart, input, toStateMoore);
+			mooreMachine.SetTransition(mealyStart, input, toStateMoore);
 		}
 	}
 }
 
-MooreMachine MooreMachine::FromDotFile(const std::string& name)
+void ConvertReachable(const MealyMachine& mealyMachine, MooreMachine& mooreMachine)
 {
-	std::ifstream file(name);
-	if (!file.is_open())
+	if (mealyMachine.GetStates().empty())
 	{
-		throw std::runtime_error("Cannot open file: " + name);
+		return;
 	}
 
+	const auto mealyTransitions = mealyMachine.GetTransitions();
+
+	std::set<std::string> allOutputs;
+	for (const auto& transition : mealyTransitions)
+	{
+		allOutputs.insert(transition.second.second);
+	}
+
+	std::map<State, std::vector<const MealyMachine::MealyTransitions::value_type*>> transitionsByBase;
+	for (const auto& transition : mealyTransitions)
+	{
+		transitionsByBase[GetBaseStateName(transition.first.first, allOutputs)].push_back(&transition);
+	}
+
+	const State& mealyStart = mealyMachine.GetStartState();
+	mooreMachine.AddState(mealyStart, "(L)");
+	mooreMachine.SetStartState(mealyStart);
+
+	std::set<State> visited = {mealyStart};
+	std::queue<std::pair<State, State>> worklist;
+	worklist.emplace(mealyStart, GetBaseStateName(mealyStart, allOutputs));
+
+	while (!worklist.empty())
+	{
+		const auto [fromStateMoore, baseName] = worklist.front();
+		worklist.pop();
+
+		const auto it = transitionsByBase.find(baseName);
+		if (it == transitionsByBase.end())
+		{
+			continue;
+		}
+
+		for (const auto* mealyTrans : it->second)
+		{
+			const auto& input = mealyTrans->first.second;
+			const auto& toStateMealy = mealyTrans->second.first;
+			const auto& output = mealyTrans->second.second;
+
+			State toBaseName = GetBaseStateName(toStateMealy, allOutputs);
+			State toStateMoore = toBaseName + "_" + output;
+
+			if (visited.insert(toStateMoore).second)
+			{
+				mooreMachine.AddState(toStateMoore, output);
+				worklist.emplace(toStateMoore, std::move(toBaseName));
+			}
+
+			mooreMachine.SetTransition(fromStateMoore, input, toStateMoore);
+		}
+	}
+}
+
+struct MooreParts
+{
+	std::set<State> states;
+	MooreMachine::MooreOutputs outputs;
+	MooreMachine::MooreTransitions transitions;
+};
+
+// Same result as ConvertFull. Names, state and transition fragments are built per chunk of Mealy transitions, merged
+// in transition order so that later transitions win as in a sequential overwrite, and turned into the maps by
+// BuildSortedContainer
+MooreParts ConvertParallel(const std::set<State>& mealyStates, const MealyMachine::MealyTransitions& mealyTransitions, const State& mealyStart)
+{
+	if (mealyStates.empty())
+	{
+		return {};
+	}
+
+	const auto transitions = GatherPointers(mealyTransitions);
+	const size_t chunkCount = GetChunkCount(transitions.size());
+
+	std::vector<std::set<std::string>> outputFragments(chunkCount);
+	ForEachChunk(transitions.size(), chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			outputFragments[chunk].insert(transitions[i]->second.second);
+		}
+	});
+	std::set<std::string> allOutputs;
+	for (auto& fragment : outputFragments)
+	{
+		allOutputs.merge(fragment);
+	}
+
+	std::vector<State> fromBaseNames(transitions.size());
+	std::vector<State> toBaseNames(transitions.size());
+	std::vector<State> toMooreStates(transitions.size());
+
+	struct NamedState
+	{
+		const State* name;
+		const std::string* output;
+	};
+	struct BaseState
+	{
+		const State* base;
+		const State* name;
+	};
+	const auto nameLess = [](const NamedState& a, const NamedState& b) {
+		return *a.name < *b.name;
+	};
+	const auto baseLess = [](const BaseState& a, const BaseState& b) {
+		return std::tie(*a.base, *a.name) < std::tie(*b.base, *b.name);
+	};
+
+	std::vector<std::vector<NamedState>> stateFragments(chunkCount);
+	std::vector<std::vector<BaseState>> baseFragments(chunkCount);
+	ForEachChunk(transitions.size(), chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+		auto& states = stateFragments[chunk];
+		auto& bases = baseFragments[chunk];
+		states.reserve(end - begin);
+		bases.reserve(end - begin);
+		for (size_t i = begin; i < end; ++i)
+		{
+			const std::string& output = transitions[i]->second.second;
+			fromBaseNames[i] = GetBaseStateName(transitions[i]->first.first, allOutputs);
+			toBaseNames[i] = GetBaseStateName(transitions[i]->second.first, allOutputs);
+			toMooreStates[i] = toBaseNames[i] + "_" + output;
+			states.push_back({&toMooreStates[i], &output});
+			bases.push_back({&toBaseNames[i], &toMooreStates[i]});
+		}
+		SortKeepLast(states, nameLess);
+		SortKeepLast(bases, baseLess);
+	});
+
+	const auto mooreStates = MergeKeepLast(std::move(stateFragments), nameLess);
+	// Moore states grouped by the base name of their Mealy state, in name order within a group
+	const auto statesByBase = MergeKeepLast(std::move(baseFragments), baseLess);
+	const State startBaseName = GetBaseStateName(mealyStart, allOutputs);
+
+	struct Entry
+	{
+		const State* fromState;
+		const std::string* input;
+		const State* toState;
+	};
+	const auto keyLess = [](const Entry& a, const Entry& b) {
+		return std::tie(*a.fromState, *a.input) < std::tie(*b.fromState, *b.input);
+	};
+
+	std::vector<std::vector<Entry>> fragments(chunkCount);
+	ForEachChunk(transitions.size(), chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+		auto& fragment = fragments[chunk];
+		for (size_t i = begin; i < end; ++i)
+		{
+			const std::string& input = transitions[i]->first.second;
+			const auto group = std::ranges::equal_range(statesByBase, fromBaseNames[i], std::less<>{}, [](const BaseState& state) -> const State& { return *state.base; });
+			for (const auto& fromState : group)
+			{
+				fragment.push_back({fromState.name, &input, &toMooreStates[i]});
+			}
+			if (fromBaseNames[i] == startBaseName)
+			{
+				fragment.push_back({&mealyStart, &input, &toMooreStates[i]});
+			}
+		}
+		SortKeepLast(fragment, keyLess);
+	});
+	const auto mooreTransitions = MergeKeepLast(std::move(fragments), keyLess);
+
+	MooreParts parts;
+	parts.states = BuildSortedContainer<std::set<State>>(mooreStates.size(), [&](size_t i) { return *mooreStates[i].name; });
+	parts.outputs = BuildSortedContainer<MooreMachine::MooreOutputs>(mooreStates.size(), [&](size_t i) {
+		return std::make_pair(*mooreStates[i].name, *mooreStates[i].output);
+	});
+	parts.states.insert(mealyStart);
+	parts.outputs[mealyStart] = "(L)";
+	parts.transitions = BuildSortedContainer<MooreMachine::MooreTransitions>(mooreTransitions.size(), [&](size_t i) {
+		const auto& entry = mooreTransitions[i];
+		return std::make_pair(std::make_pair(*entry.fromState, *entry.input), *entry.toState);
+	});
+	return parts;
+}
+} // namespace
+
+MooreMachine::MooreMachine(State initState)
+	: m_startState(std::move(initState))
+{
+}
+
+MooreMachine::MooreMachine(const MealyMachine& mealyMachine)
+	: MooreMachine(mealyMachine, ConversionMode::Full)
+{
+}
+
+MooreMachine::MooreMachine(const MealyMachine& mealyMachine, ConversionMode mode)
+{
+	switch (mode)
+	{
+	case ConversionMode::Full:
+		ConvertFull(mealyMachine, *this);
+		break;
+	case ConversionMode::ReachableOnly:
+		ConvertReachable(mealyMachine, *this);
+		break;
+	case ConversionMode::Parallel:
+	{
+		auto parts = ConvertParallel(mealyMachine.m_states, mealyMachine.m_transitions, mealyMachine.m_startState);
+		m_states = std::move(parts.states);
+		m_outputs = std::move(parts.outputs);
+		m_transitions = std::move(parts.transitions);
+		if (!m_states.empty())
+		{
+			m_startState = mealyMachine.m_startState;
+		}
+		break;
+	}
+	}
+}
+
+MooreMachine MooreMachine::FromDotFile(const std::string& name)
+{
+	const MappedFile file(name);
+
 	MooreMachine machine;
-	ParseDotMoore(machine, file);
+	ParseDotMoore(machine, file.GetView());
 
 	return machine;
 }
@@ -208,29 +382,49 @@ MooreMachine MooreMachine::FromDotFile(const std::string& name)
 std::string MooreMachine::ToDotString() const
 {
 	std::ostringstream oss;
-	oss << "digraph MooreMachine {" << std::endl;
+	WriteDot(oss);
+	return oss.str();
+}
+
+void MooreMachine::WriteDot(std::ostream& output) const
+{
+	BufferedWriter writer(output);
+	writer << "digraph MooreMachine {\n";
 
 	for (const auto& state : m_states)
 	{
-		const std::string& output = m_outputs.at(state);
-		oss << state << " [label = \"" << state << "/" << output << "\"]" << std::endl;
+		writer << state << " [label = \"" << state << "/" << m_outputs.at(state) << "\"]\n";
 	}
-	oss << std::endl;
+	writer << '\n';
 
-	std::vector<std::tuple<State, State, std::string>> sortedTransitions;
-	for (const auto& trans : m_transitions)
+	// The map already groups transitions by source state, so only the transitions of one state are ordered by
+	// (target, input) here
+	std::vector<const MooreTransitions::value_type*> group;
+	for (auto it = m_transitions.begin(); it != m_transitions.end();)
 	{
-		sortedTransitions.emplace_back(trans.first.first, trans.second, trans.first.second);
-	}
-	std::ranges::sort(sortedTransitions);
+		group.clear();
+		const State& from = it->first.first;
+		for (; it != m_transitions.end() && it->first.first == from; ++it)
+		{
+			group.push_back(&*it);
+		}
+		std::ranges::sort(group, [](const auto* left, const auto* right) {
+			return std::tie(left->second, left->first.second) < std::tie(right->second, right->first.second);
+		});
 
-	for (const auto& transition : sortedTransitions)
-	{
-		oss << std::get<0>(transition) << " -> " << std::get<1>(transition) << " [label = \"" << std::get<2>(transition) << "\"]" << std::endl;
+		for (const auto* transition : group)
+		{
+			writer << from << " -> " << transition->second << " [label = \"" << transition->first.second << "\"]\n";
+		}
 	}
 
-	oss << "}" << std::endl;
-	return oss.str();
+	writer << "}\n";
+	writer.Flush();
+}
+
+std::string MooreMachine::ToCppSource(const std::string& name) const
+{
+	return WriteCppSource(MachineTable(*this), name);
 }
 
 std::string MooreMachine::Print() const
@@ -293,6 +487,12 @@ std::string MooreMachine::Print() const
 	return oss.str();
 }
 
+MachineTable::NamedRunResult MooreMachine::Run(std::span<const std::string> inputs, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	const MachineTable table(*this);
+	return table.Decode(table.Run(inputs, policy, mode));
+}
+
 std::set<State> MooreMachine::GetStates() const
 {
 	return m_states;
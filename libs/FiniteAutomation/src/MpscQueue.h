@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue for many producers and one consumer at a time. Each slot carries a sequence number:
+// producers claim a position with a CAS on the tail and publish the slot by advancing its sequence
+template <typename T>
+class MpscQueue
+{
+public:
+	explicit MpscQueue(size_t capacity)
+		: m_capacity(std::bit_ceil(std::max<size_t>(capacity, 2)))
+		, m_slots(std::make_unique<Slot[]>(m_capacity))
+	{
+		for (size_t i = 0; i < m_capacity; ++i)
+		{
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool TryPush(const T& value)
+	{
+		size_t position = m_tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& slot = m_slots[position & (m_capacity - 1)];
+			const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+			if (difference == 0)
+			{
+				if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					slot.value = value;
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Must not run concurrently with another TryPop
+	bool TryPop(T& value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		Slot& slot = m_slots[head & (m_capacity - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+		{
+			return false;
+		}
+		value = slot.value;
+		slot.sequence.store(head + m_capacity, std::memory_order_release);
+		m_head.store(head + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// A hint when called outside the consumer
+	[[nodiscard]] bool IsEmpty() const
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		return m_slots[head & (m_capacity - 1)].sequence.load(std::memory_order_acquire) != head + 1;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence = 0;
+		T value{};
+	};
+
+	static constexpr size_t CACHE_LINE = 64;
+
+	size_t m_capacity;
+	std::unique_ptr<Slot[]> m_slots;
+	alignas(CACHE_LINE) std::atomic<size_t> m_tail = 0;
+	alignas(CACHE_LINE) std::atomic<size_t> m_head = 0;
+};
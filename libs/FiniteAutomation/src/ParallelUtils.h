@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+constexpr size_t MIN_ITEMS_PER_CHUNK = 1 << 14;
+
+inline size_t GetWorkerCount()
+{
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+inline size_t GetChunkCount(size_t itemCount, size_t minItemsPerChunk = MIN_ITEMS_PER_CHUNK)
+{
+	const size_t byItems = (itemCount + minItemsPerChunk - 1) / minItemsPerChunk;
+	return std::clamp<size_t>(byItems, 1, GetWorkerCount());
+}
+
+// Calls func(chunkIndex, begin, end) for every chunk of [0, itemCount); the first chunk runs on the caller thread
+template <typename Func>
+void ForEachChunk(size_t itemCount, size_t chunkCount, Func&& func)
+{
+	chunkCount = std::max<size_t>(1, std::min(chunkCount, std::max<size_t>(1, itemCount)));
+	const size_t chunkSize = (itemCount + chunkCount - 1) / chunkCount;
+
+	std::vector<std::exception_ptr> errors(chunkCount);
+	auto runChunk = [&](size_t chunk) {
+		try
+		{
+			const size_t begin = std::min(itemCount, chunk * chunkSize);
+			const size_t end = std::min(itemCount, begin + chunkSize);
+			func(chunk, begin, end);
+		}
+		catch (...)
+		{
+			errors[chunk] = std::current_exception();
+		}
+	};
+
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(chunkCount - 1);
+		for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+		{
+			workers.emplace_back(runChunk, chunk);
+		}
+		runChunk(0);
+	}
+
+	for (const auto& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+// Sorts by key and keeps the last of equal elements, i.e. the one a sequential overwrite would leave
+template <typename T, typename Less>
+void SortKeepLast(std::vector<T>& items, Less less)
+{
+	std::ranges::stable_sort(items, less);
+
+	size_t write = 0;
+	for (size_t read = 0; read < items.size(); ++read)
+	{
+		if (write > 0 && !less(items[write - 1], items[read]))
+		{
+			items[write - 1] = std::move(items[read]);
+		}
+		else
+		{
+			items[write++] = std::move(items[read]);
+		}
+	}
+	items.resize(write);
+}
+
+// Merges fragments produced by SortKeepLast; on equal keys the later fragment wins
+template <typename T, typename Less>
+std::vector<T> MergeKeepLast(std::vector<std::vector<T>> fragments, Less less)
+{
+	if (fragments.empty())
+	{
+		return {};
+	}
+
+	while (fragments.size() > 1)
+	{
+		std::vector<std::vector<T>> merged((fragments.size() + 1) / 2);
+		ForEachChunk(merged.size(), merged.size(), [&](size_t index, size_t, size_t) {
+			auto& left = fragments[2 * index];
+			if (2 * index + 1 == fragments.size())
+			{
+				merged[index] = std::move(left);
+				return;
+			}
+
+			auto& right = fragments[2 * index + 1];
+			auto& result = merged[index];
+			result.reserve(left.size() + right.size());
+
+			size_t i = 0;
+			size_t j = 0;
+			while (i < left.size() && j < right.size())
+			{
+				if (less(left[i], right[j]))
+				{
+					result.push_back(std::move(left[i++]));
+				}
+				else if (less(right[j], left[i]))
+				{
+					result.push_back(std::move(right[j++]));
+				}
+				else
+				{
+					++i;
+					result.push_back(std::move(right[j++]));
+				}
+			}
+			std::move(left.begin() + static_cast<std::ptrdiff_t>(i), left.end(), std::back_inserter(result));
+			std::move(right.begin() + static_cast<std::ptrdiff_t>(j), right.end(), std::back_inserter(result));
+		});
+		fragments = std::move(merged);
+	}
+
+	return std::move(fragments.front());
+}
+
+// Addresses of the elements of a container, so that its items can be split into chunks by index
+template <typename Container>
+std::vector<const typename Container::value_type*> GatherPointers(const Container& container)
+{
+	std::vector<const typename Container::value_type*> pointers;
+	pointers.reserve(container.size());
+	for (const auto& item : container)
+	{
+		pointers.push_back(&item);
+	}
+	return pointers;
+}
+
+// Builds a std::set or std::map from makeValue(0), ..., makeValue(itemCount - 1), which must be sorted by key without
+// duplicates. Every chunk becomes a container of its own on a worker thread, so node allocation and key copies run
+// in parallel; the nodes are then moved into the result in order with end hints, which only relinks them
+template <typename Container, typename Func>
+Container BuildSortedContainer(size_t itemCount, Func&& makeValue)
+{
+	const size_t chunkCount = GetChunkCount(itemCount);
+	std::vector<Container> runs(chunkCount);
+	ForEachChunk(itemCount, chunkCount, [&](size_t chunk, size_t begin, size_t end) {
+		auto& run = runs[chunk];
+		for (size_t i = begin; i < end; ++i)
+		{
+			run.insert(run.end(), makeValue(i));
+		}
+	});
+
+	Container result;
+	for (auto& run : runs)
+	{
+		while (!run.empty())
+		{
+			result.insert(result.end(), run.extract(run.begin()));
+		}
+	}
+	return result;
+}
@@ -0,0 +1,279 @@
+#include "SessionEngine.h"
+#include "Prefetch.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+using Id = SessionEngine::Id;
+using Event = SessionEngine::Event;
+using Cell = MachineTable::Cell;
+
+constexpr size_t PREFETCH_DISTANCE = 8;
+constexpr size_t BITS_PER_WORD = 64;
+
+void Step(const Cell* cells, size_t inputCount, Id& state, Id input, Id& output)
+{
+	const Cell cell = input < inputCount ? cells[static_cast<size_t>(state) * inputCount + input] : Cell{};
+	if (cell.next != MachineTable::NO_ID)
+	{
+		state = cell.next;
+	}
+	output = cell.output;
+}
+} // namespace
+
+SessionEngine::SessionEngine(const MachineTable& table, size_t sessionCount)
+	: m_table(table)
+{
+	AddSessions(sessionCount);
+}
+
+SessionEngine::SessionId SessionEngine::AddSession()
+{
+	AddSessions(1);
+	return static_cast<SessionId>(m_states.size() - 1);
+}
+
+void SessionEngine::AddSessions(size_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	if (m_table.GetStartState() == MachineTable::NO_ID)
+	{
+		throw std::runtime_error("Machine has no start state");
+	}
+	const size_t first = m_states.size();
+	m_states.resize(first + count, m_table.GetStartState());
+	m_changed.resize((m_states.size() + BITS_PER_WORD - 1) / BITS_PER_WORD);
+	for (size_t session = first; session < m_states.size(); ++session)
+	{
+		MarkChanged(static_cast<SessionId>(session), true);
+	}
+}
+
+void SessionEngine::ResetSession(SessionId session)
+{
+	CheckSession(session);
+	m_states[session] = m_table.GetStartState();
+	MarkChanged(session, true);
+}
+
+size_t SessionEngine::GetSessionCount() const
+{
+	return m_states.size();
+}
+
+SessionEngine::Id SessionEngine::GetState(SessionId session) const
+{
+	CheckSession(session);
+	return m_states[session];
+}
+
+void SessionEngine::SetState(SessionId session, Id state)
+{
+	CheckSession(session);
+	if (state >= m_table.GetStateCount())
+	{
+		throw std::out_of_range("Unknown state id " + std::to_string(state));
+	}
+	m_states[session] = state;
+	MarkChanged(session, true);
+}
+
+std::span<const SessionEngine::Id> SessionEngine::GetStates() const
+{
+	return m_states;
+}
+
+const MachineTable& SessionEngine::GetTable() const
+{
+	return m_table;
+}
+
+std::vector<SessionEngine::SessionId> SessionEngine::GetChangedSessions() const
+{
+	std::vector<SessionId> sessions;
+	for (size_t word = 0; word < m_changed.size(); ++word)
+	{
+		for (std::uint64_t bits = m_changed[word]; bits != 0; bits &= bits - 1)
+		{
+			sessions.push_back(static_cast<SessionId>(word * BITS_PER_WORD + static_cast<size_t>(std::countr_zero(bits))));
+		}
+	}
+	return sessions;
+}
+
+void SessionEngine::ClearChanges()
+{
+	std::ranges::fill(m_changed, 0);
+}
+
+std::uint64_t SessionEngine::GetCheckpointSequence() const
+{
+	return m_checkpointSequence;
+}
+
+void SessionEngine::SetCheckpointSequence(std::uint64_t sequence)
+{
+	m_checkpointSequence = sequence;
+}
+
+void SessionEngine::Apply(std::span<const Event> events, std::span<Id> outputs, SessionBatchOrder order)
+{
+	if (outputs.size() < events.size())
+	{
+		throw std::invalid_argument("Outputs must hold one entry per event");
+	}
+	for (const auto& event : events)
+	{
+		CheckSession(event.session);
+	}
+
+	switch (order)
+	{
+	case SessionBatchOrder::Arrival:
+		ApplyInArrivalOrder(events, outputs);
+		break;
+	case SessionBatchOrder::ByState:
+		ApplyByState(events, outputs);
+		break;
+	}
+}
+
+std::vector<SessionEngine::Id> SessionEngine::Apply(std::span<const Event> events, SessionBatchOrder order)
+{
+	std::vector<Id> outputs(events.size());
+	Apply(events, outputs, order);
+	return outputs;
+}
+
+void SessionEngine::ApplyInArrivalOrder(std::span<const Event> events, std::span<Id> outputs)
+{
+	Id* states = m_states.data();
+	const Cell* cells = m_table.GetCells().data();
+	const size_t inputCount = m_table.GetInputCount();
+
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		if (i + 2 * PREFETCH_DISTANCE < events.size())
+		{
+			PrefetchForRead(states + events[i + 2 * PREFETCH_DISTANCE].session);
+		}
+		if (i + PREFETCH_DISTANCE < events.size())
+		{
+			const Event& ahead = events[i + PREFETCH_DISTANCE];
+			if (ahead.input < inputCount)
+			{
+				PrefetchForRead(cells + static_cast<size_t>(states[ahead.session]) * inputCount + ahead.input);
+			}
+		}
+		const SessionId session = events[i].session;
+		const Id before = states[session];
+		Step(cells, inputCount, states[session], events[i].input, outputs[i]);
+		MarkChanged(session, states[session] != before);
+	}
+}
+
+void SessionEngine::ApplyByState(std::span<const Event> events, std::span<Id> outputs)
+{
+	m_eventCounts.resize(m_states.size());
+	m_eventRounds.resize(events.size());
+
+	size_t roundCount = 0;
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		m_eventRounds[i] = m_eventCounts[events[i].session]++;
+		roundCount = std::max<size_t>(roundCount, m_eventRounds[i] + 1);
+	}
+	for (const auto& event : events)
+	{
+		m_eventCounts[event.session] = 0;
+	}
+
+	std::vector<size_t> roundStarts(roundCount + 1);
+	for (const auto round : m_eventRounds)
+	{
+		++roundStarts[round + 1];
+	}
+	for (size_t round = 0; round < roundCount; ++round)
+	{
+		roundStarts[round + 1] += roundStarts[round];
+	}
+
+	m_roundOrder.resize(events.size());
+	std::vector<size_t> positions(roundStarts.begin(), roundStarts.end() - 1);
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		m_roundOrder[positions[m_eventRounds[i]]++] = static_cast<std::uint32_t>(i);
+	}
+
+	for (size_t round = 0; round < roundCount; ++round)
+	{
+		const auto roundEvents = std::span<const std::uint32_t>(m_roundOrder).subspan(roundStarts[round], roundStarts[round + 1] - roundStarts[round]);
+		ApplyRound(events, roundEvents, outputs);
+	}
+}
+
+void SessionEngine::ApplyRound(std::span<const Event> events, std::span<const std::uint32_t> round, std::span<Id> outputs)
+{
+	const size_t stateCount = m_table.GetStateCount();
+	m_pending.resize(round.size());
+	for (size_t i = 0; i < round.size(); ++i)
+	{
+		const Event& event = events[round[i]];
+		m_pending[i] = {m_states[event.session], event.session, event.input, round[i]};
+	}
+
+	if (stateCount <= 2 * round.size())
+	{
+		m_stateStarts.assign(stateCount + 1, 0);
+		for (const auto& pending : m_pending)
+		{
+			++m_stateStarts[pending.state + 1];
+		}
+		for (size_t state = 0; state < stateCount; ++state)
+		{
+			m_stateStarts[state + 1] += m_stateStarts[state];
+		}
+
+		m_bucketed.resize(round.size());
+		for (const auto& pending : m_pending)
+		{
+			m_bucketed[m_stateStarts[pending.state]++] = pending;
+		}
+		std::swap(m_pending, m_bucketed);
+	}
+	else
+	{
+		std::ranges::sort(m_pending, {}, &PendingEvent::state);
+	}
+
+	const Cell* cells = m_table.GetCells().data();
+	const size_t inputCount = m_table.GetInputCount();
+	for (auto& pending : m_pending)
+	{
+		const Id before = pending.state;
+		Step(cells, inputCount, pending.state, pending.input, outputs[pending.index]);
+		m_states[pending.session] = pending.state;
+		MarkChanged(pending.session, pending.state != before);
+	}
+}
+
+void SessionEngine::MarkChanged(SessionId session, bool changed)
+{
+	m_changed[session / BITS_PER_WORD] |= std::uint64_t{changed} << (session % BITS_PER_WORD);
+}
+
+void SessionEngine::CheckSession(SessionId session) const
+{
+	if (session >= m_states.size())
+	{
+		throw std::out_of_range("Unknown session id " + std::to_string(session));
+	}
+}
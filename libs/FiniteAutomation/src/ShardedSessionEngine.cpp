@@ -0,0 +1,229 @@
+#include "ShardedSessionEngine.h"
+#include "MpscQueue.h"
+#include "ParallelUtils.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+constexpr size_t SHARDS_PER_WORKER = 4;
+constexpr size_t MAX_SHARD_BATCH = 4096;
+} // namespace
+
+struct ShardedSessionEngine::Shard
+{
+	Shard(const MachineTable& table, size_t sessionCount, size_t queueCapacity)
+		: queue(queueCapacity)
+		, engine(table, sessionCount)
+	{
+	}
+
+	bool TryClaim()
+	{
+		return !claimed.exchange(true, std::memory_order_acquire);
+	}
+
+	void Claim()
+	{
+		while (!TryClaim())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Release()
+	{
+		claimed.store(false, std::memory_order_release);
+	}
+
+	MpscQueue<Event> queue;
+	alignas(64) std::atomic<bool> claimed = false;
+	SessionEngine engine;
+	std::vector<Event> batch;
+	std::vector<SessionId> batchSessions;
+	std::vector<Id> batchOutputs;
+	std::vector<Emission> outputs;
+};
+
+ShardedSessionEngine::ShardedSessionEngine(const MachineTable& table, size_t sessionCount, size_t workerCount, size_t shardCount, size_t queueCapacity)
+	: m_sessionCount(sessionCount)
+	, m_workerCount(workerCount == 0 ? ::GetWorkerCount() : workerCount)
+{
+	shardCount = shardCount == 0 ? m_workerCount * SHARDS_PER_WORKER : shardCount;
+
+	m_shards.reserve(shardCount);
+	for (size_t shard = 0; shard < shardCount; ++shard)
+	{
+		const size_t shardSessions = sessionCount / shardCount + (shard < sessionCount % shardCount ? 1 : 0);
+		m_shards.push_back(std::make_unique<Shard>(table, shardSessions, queueCapacity));
+	}
+
+	m_workers.reserve(m_workerCount);
+	for (size_t worker = 0; worker < m_workerCount; ++worker)
+	{
+		m_workers.emplace_back([this, worker](std::stop_token stop) { RunWorker(stop, worker); });
+	}
+}
+
+ShardedSessionEngine::~ShardedSessionEngine()
+{
+	for (auto& worker : m_workers)
+	{
+		worker.request_stop();
+	}
+	m_pendingEvents.fetch_add(1);
+	m_pendingEvents.notify_all();
+	m_workers.clear();
+}
+
+void ShardedSessionEngine::Submit(const Event& event)
+{
+	Submit(std::span(&event, 1));
+}
+
+void ShardedSessionEngine::Submit(std::span<const Event> events)
+{
+	for (const auto& event : events)
+	{
+		CheckSession(event.session);
+	}
+	if (events.empty())
+	{
+		return;
+	}
+
+	if (m_pendingEvents.fetch_add(events.size()) == 0)
+	{
+		m_pendingEvents.notify_all();
+	}
+
+	const size_t shardCount = m_shards.size();
+	for (const auto& event : events)
+	{
+		auto& queue = m_shards[event.session % shardCount]->queue;
+		while (!queue.TryPush(event))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ShardedSessionEngine::Flush()
+{
+	for (size_t pending = m_pendingEvents.load(); pending != 0; pending = m_pendingEvents.load())
+	{
+		m_pendingEvents.wait(pending);
+	}
+}
+
+std::vector<ShardedSessionEngine::Emission> ShardedSessionEngine::TakeOutputs()
+{
+	std::vector<Emission> outputs;
+	for (const auto& shard : m_shards)
+	{
+		shard->Claim();
+		outputs.insert(outputs.end(), shard->outputs.begin(), shard->outputs.end());
+		shard->outputs.clear();
+		shard->Release();
+	}
+	return outputs;
+}
+
+ShardedSessionEngine::Id ShardedSessionEngine::GetState(SessionId session) const
+{
+	CheckSession(session);
+	auto& shard = *m_shards[session % m_shards.size()];
+	shard.Claim();
+	const Id state = shard.engine.GetState(static_cast<SessionId>(session / m_shards.size()));
+	shard.Release();
+	return state;
+}
+
+size_t ShardedSessionEngine::GetSessionCount() const
+{
+	return m_sessionCount;
+}
+
+size_t ShardedSessionEngine::GetShardCount() const
+{
+	return m_shards.size();
+}
+
+size_t ShardedSessionEngine::GetWorkerCount() const
+{
+	return m_workerCount;
+}
+
+void ShardedSessionEngine::RunWorker(const std::stop_token& stop, size_t worker)
+{
+	const size_t shardCount = m_shards.size();
+	const size_t firstShard = worker * shardCount / m_workerCount;
+
+	while (!stop.stop_requested())
+	{
+		bool processed = false;
+		for (size_t i = 0; i < shardCount; ++i)
+		{
+			Shard& shard = *m_shards[(firstShard + i) % shardCount];
+			if (shard.queue.IsEmpty() || !shard.TryClaim())
+			{
+				continue;
+			}
+			processed = ProcessShard(shard) || processed;
+			shard.Release();
+		}
+
+		if (!processed)
+		{
+			if (m_pendingEvents.load() == 0)
+			{
+				m_pendingEvents.wait(0);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+}
+
+bool ShardedSessionEngine::ProcessShard(Shard& shard)
+{
+	const size_t shardCount = m_shards.size();
+	shard.batch.clear();
+	shard.batchSessions.clear();
+
+	Event event;
+	while (shard.batch.size() < MAX_SHARD_BATCH && shard.queue.TryPop(event))
+	{
+		shard.batchSessions.push_back(event.session);
+		event.session = static_cast<SessionId>(event.session / shardCount);
+		shard.batch.push_back(event);
+	}
+	if (shard.batch.empty())
+	{
+		return false;
+	}
+
+	shard.batchOutputs.resize(shard.batch.size());
+	shard.engine.Apply(shard.batch, shard.batchOutputs);
+	for (size_t i = 0; i < shard.batch.size(); ++i)
+	{
+		shard.outputs.push_back({shard.batchSessions[i], shard.batchOutputs[i]});
+	}
+
+	if (m_pendingEvents.fetch_sub(shard.batch.size()) == shard.batch.size())
+	{
+		m_pendingEvents.notify_all();
+	}
+	return true;
+}
+
+void ShardedSessionEngine::CheckSession(SessionId session) const
+{
+	if (session >= m_sessionCount)
+	{
+		throw std::out_of_range("Unknown session id " + std::to_string(session));
+	}
+}
@@ -0,0 +1,168 @@
+#include "StateLayout.h"
+
+#include <algorithm>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+using Id = MachineTable::Id;
+} // namespace
+
+TransitionProfile::TransitionProfile(const MachineTable& table)
+	: m_table(table)
+	, m_inputCount(table.GetInputCount())
+	, m_hits(table.GetCells().size(), 0)
+{
+}
+
+std::span<const std::uint64_t> TransitionProfile::GetHits() const
+{
+	return m_hits;
+}
+
+std::uint64_t TransitionProfile::GetHits(Id state, Id input) const
+{
+	if (state >= m_table.GetStateCount() || input >= m_inputCount)
+	{
+		throw std::out_of_range("Unknown transition " + std::to_string(state) + ", " + std::to_string(input));
+	}
+	return m_hits[static_cast<size_t>(state) * m_inputCount + input];
+}
+
+void TransitionProfile::Clear()
+{
+	std::ranges::fill(m_hits, 0);
+}
+
+void TransitionProfile::Merge(const TransitionProfile& other)
+{
+	if (other.m_hits.size() != m_hits.size() || other.m_inputCount != m_inputCount)
+	{
+		throw std::invalid_argument("Profiles of different tables cannot be merged");
+	}
+	for (size_t i = 0; i < m_hits.size(); ++i)
+	{
+		m_hits[i] += other.m_hits[i];
+	}
+}
+
+std::vector<Id> ComputeHotStateOrder(const MachineTable& table, std::span<const std::uint64_t> hits)
+{
+	const auto cells = table.GetCells();
+	if (hits.size() != cells.size())
+	{
+		throw std::invalid_argument("Hit counters do not match the table");
+	}
+
+	const size_t stateCount = table.GetStateCount();
+	const size_t inputCount = table.GetInputCount();
+
+	// A state is as hot as the transitions entering and leaving it
+	std::vector<std::uint64_t> heat(stateCount, 0);
+	for (size_t i = 0; i < cells.size(); ++i)
+	{
+		if (hits[i] != 0 && cells[i].next != MachineTable::NO_ID)
+		{
+			heat[i / inputCount] += hits[i];
+			heat[cells[i].next] += hits[i];
+		}
+	}
+
+	std::vector<Id> seeds(stateCount);
+	std::iota(seeds.begin(), seeds.end(), Id{0});
+	std::ranges::stable_sort(seeds, [&](Id left, Id right) { return heat[left] > heat[right]; });
+
+	std::vector<Id> order;
+	order.reserve(stateCount);
+	std::vector<bool> placed(stateCount, false);
+	// Hits per successor of the current state; touched lists the entries to reset
+	std::vector<std::uint64_t> successorHits(stateCount, 0);
+	std::vector<Id> touched;
+
+	for (const Id seed : seeds)
+	{
+		Id state = seed;
+		while (state != MachineTable::NO_ID && !placed[state])
+		{
+			placed[state] = true;
+			order.push_back(state);
+
+			touched.clear();
+			for (size_t input = 0; input < inputCount; ++input)
+			{
+				const size_t index = static_cast<size_t>(state) * inputCount + input;
+				const Id next = cells[index].next;
+				if (hits[index] != 0 && next != MachineTable::NO_ID && !placed[next])
+				{
+					if (successorHits[next] == 0)
+					{
+						touched.push_back(next);
+					}
+					successorHits[next] += hits[index];
+				}
+			}
+
+			state = MachineTable::NO_ID;
+			std::uint64_t best = 0;
+			for (const Id next : touched)
+			{
+				if (successorHits[next] > best || (successorHits[next] == best && next < state))
+				{
+					best = successorHits[next];
+					state = next;
+				}
+				successorHits[next] = 0;
+			}
+		}
+	}
+
+	return order;
+}
+
+void WriteStateOrder(const MachineTable& table, std::span<const Id> order, std::ostream& output)
+{
+	for (const Id state : order)
+	{
+		output << table.GetStateName(state) << '\n';
+	}
+	if (!output)
+	{
+		throw std::runtime_error("Failed to write state order");
+	}
+}
+
+std::vector<Id> ReadStateOrder(const MachineTable& table, std::istream& input)
+{
+	const size_t stateCount = table.GetStateCount();
+	std::vector<Id> order;
+	order.reserve(stateCount);
+	std::vector<bool> placed(stateCount, false);
+
+	std::string name;
+	while (std::getline(input, name))
+	{
+		if (!name.empty() && name.back() == '\r')
+		{
+			name.pop_back();
+		}
+		const Id state = table.FindState(name);
+		if (state != MachineTable::NO_ID && !placed[state])
+		{
+			placed[state] = true;
+			order.push_back(state);
+		}
+	}
+
+	for (Id state = 0; state < stateCount; ++state)
+	{
+		if (!placed[state])
+		{
+			order.push_back(state);
+		}
+	}
+	return order;
+}
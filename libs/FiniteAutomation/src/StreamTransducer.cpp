@@ -0,0 +1,157 @@
+#include "StreamTransducer.h"
+#include "BufferedWriter.h"
+#include "MappedFile.h"
+
+#include <array>
+#include <charconv>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+using Id = StreamTransducer::Id;
+
+constexpr size_t TOKEN_BLOCK_SIZE = 4096;
+
+bool IsSpace(char ch)
+{
+	return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+}
+
+class NumberText
+{
+public:
+	explicit NumberText(size_t value)
+		: m_size(static_cast<size_t>(std::to_chars(m_digits.data(), m_digits.data() + m_digits.size(), value).ptr - m_digits.data()))
+	{
+	}
+
+	[[nodiscard]] std::string_view GetView() const
+	{
+		return {m_digits.data(), m_size};
+	}
+
+private:
+	std::array<char, 24> m_digits{};
+	size_t m_size;
+};
+} // namespace
+
+StreamTransducer::StreamTransducer(const MachineTable& table, size_t bufferBytes)
+	: m_table(table)
+	, m_bufferBytes(bufferBytes)
+{
+}
+
+StreamTransducer::Result StreamTransducer::RunFile(const std::string& name, std::ostream& output, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	const MappedFile file(name);
+	return Run(file.GetView(), output, policy, mode);
+}
+
+StreamTransducer::Result StreamTransducer::Run(std::string_view input, std::ostream& output, UndefinedTransitionPolicy policy, OutputMode mode) const
+{
+	std::vector<std::string_view> outputNames(m_table.GetOutputCount());
+	for (Id id = 0; id < outputNames.size(); ++id)
+	{
+		outputNames[id] = m_table.GetOutputName(id);
+	}
+
+	BufferedWriter writer(output, m_bufferBytes);
+	Result result;
+	result.finalState = m_table.GetStartState();
+	Id previous = MachineTable::NO_ID;
+	size_t runLength = 0;
+	const auto flushRun = [&] {
+		if (runLength > 0)
+		{
+			writer << outputNames[previous] << ' ' << NumberText(runLength).GetView() << '\n';
+		}
+	};
+	const auto sink = [&](Id id) {
+		switch (mode)
+		{
+		case OutputMode::Every:
+			writer << outputNames[id] << '\n';
+			break;
+		case OutputMode::OnChange:
+			if (result.emitted == 0 || id != previous)
+			{
+				writer << NumberText(result.emitted).GetView() << ' ' << outputNames[id] << '\n';
+			}
+			break;
+		case OutputMode::RunLength:
+			if (runLength > 0 && id == previous)
+			{
+				++runLength;
+				break;
+			}
+			flushRun();
+			runLength = 1;
+			break;
+		}
+		previous = id;
+		++result.emitted;
+	};
+
+	const auto finish = [&] {
+		if (mode == OutputMode::RunLength)
+		{
+			flushRun();
+		}
+		writer.Flush();
+	};
+
+	std::vector<Id> block;
+	block.reserve(TOKEN_BLOCK_SIZE);
+
+	const char* position = input.data();
+	const char* end = position + input.size();
+	while (position != end)
+	{
+		block.clear();
+		while (position != end && block.size() < TOKEN_BLOCK_SIZE)
+		{
+			while (position != end && IsSpace(*position))
+			{
+				++position;
+			}
+			const char* tokenBegin = position;
+			while (position != end && !IsSpace(*position))
+			{
+				++position;
+			}
+			if (tokenBegin != position)
+			{
+				block.push_back(m_table.FindInput(std::string_view(tokenBegin, static_cast<size_t>(position - tokenBegin))));
+			}
+		}
+
+		size_t consumed = 0;
+		try
+		{
+			consumed = m_table.RunInto(block, result.finalState, sink, policy);
+		}
+		catch (...)
+		{
+			// The stream already holds earlier flushes, so it gets the outputs of every consumed input. A failed write
+			// must not replace the error that stopped the run
+			try
+			{
+				finish();
+			}
+			catch (...)
+			{
+			}
+			throw;
+		}
+		result.consumed += consumed;
+		if (consumed < block.size())
+		{
+			break;
+		}
+	}
+
+	finish();
+	return result;
+}
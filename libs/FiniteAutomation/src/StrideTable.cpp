@@ -0,0 +1,79 @@
+#include "StrideTable.h"
+
+namespace
+{
+using Id = StrideTable::Id;
+
+size_t GetEntryBytes(size_t stride)
+{
+	return 2 * sizeof(Id) + stride * sizeof(Id);
+}
+} // namespace
+
+StrideTable::StrideTable(const MachineTable& table, size_t budgetBytes)
+	: m_table(table)
+{
+	const size_t stateCount = table.GetStateCount();
+	const size_t inputCount = table.GetInputCount();
+
+	m_wordCount = inputCount;
+	while (inputCount > 0 && m_stride < MAX_STRIDE)
+	{
+		const size_t nextWordCount = m_wordCount * inputCount;
+		if (stateCount * nextWordCount * GetEntryBytes(m_stride + 1) > budgetBytes)
+		{
+			break;
+		}
+		++m_stride;
+		m_wordCount = nextWordCount;
+	}
+
+	m_entries.resize(stateCount * m_wordCount);
+	m_outputs.resize(m_entries.size() * m_stride, MachineTable::NO_ID);
+
+	std::vector<Id> word(m_stride);
+	for (Id state = 0; state < stateCount; ++state)
+	{
+		for (size_t wordIndex = 0; wordIndex < m_wordCount; ++wordIndex)
+		{
+			for (size_t i = m_stride, rest = wordIndex; i-- > 0; rest /= inputCount)
+			{
+				word[i] = static_cast<Id>(rest % inputCount);
+			}
+
+			const size_t index = static_cast<size_t>(state) * m_wordCount + wordIndex;
+			Entry& entry = m_entries[index];
+			Id current = state;
+			for (; entry.steps < m_stride; ++entry.steps)
+			{
+				const auto cell = table.GetCell(current, word[entry.steps]);
+				if (cell.next == MachineTable::NO_ID)
+				{
+					break;
+				}
+				m_outputs[index * m_stride + entry.steps] = cell.output;
+				current = cell.next;
+			}
+			entry.next = current;
+		}
+	}
+}
+
+size_t StrideTable::GetStride() const
+{
+	return m_stride;
+}
+
+size_t StrideTable::GetSizeBytes() const
+{
+	return m_entries.size() * sizeof(Entry) + m_outputs.size() * sizeof(Id);
+}
+
+MachineTable::RunResult StrideTable::Run(std::span<const Id> inputs, UndefinedTransitionPolicy policy) const
+{
+	MachineTable::RunResult result;
+	result.outputs.reserve(inputs.size());
+	result.finalState = m_table.GetStartState();
+	result.consumed = RunInto(inputs, result.finalState, [&result](Id output) { result.outputs.push_back(output); }, policy);
+	return result;
+}
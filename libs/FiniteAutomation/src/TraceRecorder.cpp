@@ -0,0 +1,133 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <ostream>
+#include <stdexcept>
+
+namespace
+{
+using Id = TraceRecorder::Id;
+
+constexpr size_t WORD_BITS = 64;
+
+size_t GetBitsFor(size_t valueCount)
+{
+	return valueCount <= 1 ? 0 : static_cast<size_t>(std::bit_width(valueCount - 1));
+}
+
+std::uint64_t GetLowMask(size_t bits)
+{
+	return bits == 0 ? 0 : ~std::uint64_t{0} >> (WORD_BITS - bits);
+}
+} // namespace
+
+TraceRecorder::TraceRecorder(const MachineTable& table, size_t capacity)
+	: m_table(table)
+	, m_capacity((capacity + WORD_BITS - 1) / WORD_BITS * WORD_BITS)
+	, m_inputCount(table.GetInputCount())
+	, m_stateBits(GetBitsFor(table.GetStateCount()))
+	, m_bitsPerStep(std::max<size_t>(m_stateBits + GetBitsFor(m_inputCount + 1), 1))
+{
+	if (capacity == 0)
+	{
+		throw std::invalid_argument("Trace capacity must be positive");
+	}
+	m_words.resize(m_capacity / WORD_BITS * m_bitsPerStep);
+}
+
+size_t TraceRecorder::GetCapacity() const
+{
+	return m_capacity;
+}
+
+size_t TraceRecorder::GetBitsPerStep() const
+{
+	return m_bitsPerStep;
+}
+
+size_t TraceRecorder::GetSize() const
+{
+	return m_recorded < m_capacity ? static_cast<size_t>(m_recorded) : m_capacity;
+}
+
+std::uint64_t TraceRecorder::GetRecordedCount() const
+{
+	return m_recorded;
+}
+
+void TraceRecorder::Clear()
+{
+	m_cursor = {};
+	m_recorded = 0;
+}
+
+std::uint64_t TraceRecorder::GetWord(size_t word) const
+{
+	if (word != m_cursor.word)
+	{
+		return m_words[word];
+	}
+	const std::uint64_t pending = GetLowMask(m_cursor.fill);
+	return (m_words[word] & ~pending) | (m_cursor.bits & pending);
+}
+
+std::uint64_t TraceRecorder::Read(size_t slot) const
+{
+	const size_t bit = slot * m_bitsPerStep;
+	const size_t word = bit / WORD_BITS;
+	const size_t shift = bit % WORD_BITS;
+	std::uint64_t value = GetWord(word) >> shift;
+	if (shift + m_bitsPerStep > WORD_BITS)
+	{
+		value |= GetWord(word + 1) << (WORD_BITS - shift);
+	}
+	return value & GetLowMask(m_bitsPerStep);
+}
+
+std::vector<TraceRecorder::Step> TraceRecorder::Decode() const
+{
+	const size_t size = GetSize();
+	const size_t first = size < m_capacity ? 0 : static_cast<size_t>(m_recorded % m_capacity);
+	const std::uint64_t stateMask = GetLowMask(m_stateBits);
+
+	std::vector<Step> steps;
+	steps.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		const size_t slot = first + i < m_capacity ? first + i : first + i - m_capacity;
+		const std::uint64_t value = Read(slot);
+
+		Step step;
+		step.state = static_cast<Id>(value & stateMask);
+		const auto code = static_cast<size_t>(value >> m_stateBits);
+		step.input = code < m_inputCount ? static_cast<Id>(code) : MachineTable::NO_ID;
+		step.next = step.state;
+		if (step.input != MachineTable::NO_ID)
+		{
+			const auto cell = m_table.GetCell(step.state, step.input);
+			if (cell.next != MachineTable::NO_ID)
+			{
+				step.next = cell.next;
+				step.output = cell.output;
+			}
+		}
+		steps.push_back(step);
+	}
+	return steps;
+}
+
+void TraceRecorder::WriteReplay(std::ostream& output) const
+{
+	const auto nameOrUnknown = [](Id id, auto getName) {
+		return id == MachineTable::NO_ID ? std::string_view("?") : getName(id);
+	};
+
+	for (const auto& step : Decode())
+	{
+		output << m_table.GetStateName(step.state) << ' '
+			   << nameOrUnknown(step.input, [this](Id id) { return m_table.GetInputName(id); }) << " -> "
+			   << m_table.GetStateName(step.next) << " / "
+			   << nameOrUnknown(step.output, [this](Id id) { return m_table.GetOutputName(id); }) << '\n';
+	}
+}
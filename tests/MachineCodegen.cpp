@@ -0,0 +1,45 @@
+#include "MealyMachine.h"
+#include "MooreMachine.h"
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+void WriteFile(const std::filesystem::path& path, const std::string& content)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Cannot open file: " + path.string());
+	}
+	file << content;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		std::cerr << "Usage: MachineCodegen <mealy.dot> <moore.dot> <output dir>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		const std::filesystem::path outputDir = argv[3];
+		std::filesystem::create_directories(outputDir);
+		WriteFile(outputDir / "GeneratedMealy.h", MealyMachine::FromDotFile(argv[1]).ToCppSource("GeneratedMealy"));
+		WriteFile(outputDir / "GeneratedMoore.h", MooreMachine::FromDotFile(argv[2]).ToCppSource("GeneratedMoore"));
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,8 +1,33 @@
 ﻿#include "../libs/FiniteAutomation/src/MealyMachine.cpp"
+#include "Checkpoint.h"
+#include "CoverageCounters.h"
+#include "DotScanner.h"
+#include "GeneratedMealy.h"
+#include "GeneratedMoore.h"
+#include "LockstepRunner.h"
 #include "MealyMachine.h"
 #include "MooreMachine.h"
+#include "SessionEngine.h"
+#include "ShardedSessionEngine.h"
+#include "StateLayout.h"
+#include "StaticMachine.h"
+#include "StreamTransducer.h"
+#include "StrideTable.h"
+#include "TraceRecorder.h"
+#include "Transducer.h"
 #include "gtest/gtest.h"
 
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
 TEST(MealyMachineTest, CanCreateEmptyMachine)
 {
 	MealyMachine machine;
@@ -126,6 +151,83 @@ TEST(ConversionTest, MooreToMealyConversionIsCorrect)
 	EXPECT_EQ(transitions.at({"S2", "b"}), std::make_pair("S0", "0"));
 }
 
+TEST(ConversionTest, ReachableOnlyConversionSkipsUnreachableStates)
+{
+	MealyMachine mealy;
+	mealy.AddState("S0");
+	mealy.SetStartState("S0");
+	mealy.SetTransition("S0", "0", "S1", "1");
+	mealy.SetTransition("S1", "0", "S0", "0");
+	mealy.SetTransition("S2", "0", "S1", "9");
+
+	MooreMachine full(mealy);
+	MooreMachine reachable(mealy, ConversionMode::ReachableOnly);
+
+	EXPECT_TRUE(full.GetStates().contains("S1_9"));
+	EXPECT_FALSE(reachable.GetStates().contains("S1_9"));
+	EXPECT_FALSE(reachable.GetStates().contains("S2"));
+
+	EXPECT_EQ(reachable.GetStartState(), "S0");
+	EXPECT_EQ(reachable.GetStates(), std::set<State>({"S0", "S1_1", "S0_0"}));
+	EXPECT_EQ(reachable.GetOutputs().at("S0"), "(L)");
+
+	auto transitions = reachable.GetTransitions();
+	EXPECT_EQ(transitions.size(), 3);
+	EXPECT_EQ(transitions.at({"S0", "0"}), "S1_1");
+	EXPECT_EQ(transitions.at({"S1_1", "0"}), "S0_0");
+	EXPECT_EQ(transitions.at({"S0_0", "0"}), "S1_1");
+}
+
+TEST(ConversionTest, ReachableOnlyConversionMatchesFullWhenAllReachable)
+{
+	MealyMachine mealy;
+	mealy.AddState("S0");
+	mealy.SetStartState("S0");
+	mealy.SetTransition("S0", "0", "S1", "1");
+	mealy.SetTransition("S0", "1", "S2", "0");
+	mealy.SetTransition("S1", "0", "S2", "0");
+	mealy.SetTransition("S1", "1", "S0", "1");
+	mealy.SetTransition("S2", "0", "S0", "1");
+	mealy.SetTransition("S2", "1", "S1", "0");
+
+	MooreMachine full(mealy);
+	MooreMachine reachable(mealy, ConversionMode::ReachableOnly);
+
+	EXPECT_EQ(reachable.GetStates(), full.GetStates());
+	EXPECT_EQ(reachable.GetOutputs(), full.GetOutputs());
+	EXPECT_EQ(reachable.GetTransitions(), full.GetTransitions());
+}
+
+TEST(ConversionTest, ParallelConversionMatchesSequential)
+{
+	MealyMachine mealy;
+	mealy.AddState("S0");
+	mealy.SetStartState("S0");
+	for (int state = 0; state < 150; ++state)
+	{
+		for (int input = 0; input < 250; ++input)
+		{
+			const int toState = (state * 31 + input * 7) % 150;
+			mealy.SetTransition("S" + std::to_string(state), "x" + std::to_string(input), "S" + std::to_string(toState), (state + input) % 3 == 0 ? "a" : "b");
+		}
+	}
+
+	MooreMachine sequentialMoore(mealy);
+	MooreMachine parallelMoore(mealy, ConversionMode::Parallel);
+
+	EXPECT_EQ(parallelMoore.GetStartState(), sequentialMoore.GetStartState());
+	EXPECT_EQ(parallelMoore.GetStates(), sequentialMoore.GetStates());
+	EXPECT_EQ(parallelMoore.GetOutputs(), sequentialMoore.GetOutputs());
+	EXPECT_EQ(parallelMoore.GetTransitions(), sequentialMoore.GetTransitions());
+
+	MealyMachine sequentialMealy(sequentialMoore);
+	MealyMachine parallelMealy(sequentialMoore, ConversionMode::Parallel);
+
+	EXPECT_EQ(parallelMealy.GetStartState(), sequentialMealy.GetStartState());
+	EXPECT_EQ(parallelMealy.GetStates(), sequentialMealy.GetStates());
+	EXPECT_EQ(parallelMealy.GetTransitions(), sequentialMealy.GetTransitions());
+}
+
 // Минимизация Милли
 TEST(MealyMachineMinimizationTest, EmptyMachineMinimization)
 {
@@ -644,3 +746,1725 @@ TEST(MooreMachineMinimizationTest, MultipleEquivalentStatesMerged)
 	EXPECT_LE(minimized.GetStates().size(), 2);
 	EXPECT_LE(minimized.GetTransitions().size(), 4);
 }
+
+// Симуляция
+TEST(SimulationTest, MealyRunProducesTransitionOutputs)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+	machine.SetTransition("S1", "b", "S1", "z");
+
+	const std::vector<std::string> inputs = {"a", "b", "b", "a", "a"};
+	const auto result = machine.Run(inputs);
+
+	EXPECT_EQ(result.outputs, std::vector<std::string>({"x", "z", "z", "y", "x"}));
+	EXPECT_EQ(result.finalState, "S1");
+	EXPECT_EQ(result.consumed, 5);
+}
+
+TEST(SimulationTest, MooreRunProducesStateOutputs)
+{
+	MooreMachine machine;
+	machine.AddState("S0", "y0");
+	machine.AddState("S1", "y1");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1");
+	machine.SetTransition("S1", "a", "S0");
+	machine.SetTransition("S1", "b", "S1");
+
+	const MachineTable table(machine);
+	const std::vector<std::string> inputs = {"a", "b", "a"};
+	const auto result = table.Run(table.EncodeInputs(inputs));
+
+	EXPECT_EQ(table.GetOutputName(table.GetStateOutput(table.GetStartState())), "y0");
+	EXPECT_EQ(table.Decode(result).outputs, std::vector<std::string>({"y1", "y1", "y0"}));
+	EXPECT_EQ(table.GetStateName(result.finalState), "S0");
+}
+
+TEST(SimulationTest, UndefinedTransitionPolicies)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+
+	const std::vector<std::string> inputs = {"a", "b", "a", "c"};
+
+	EXPECT_THROW((void)machine.Run(inputs), std::runtime_error);
+
+	const auto stopped = machine.Run(inputs, UndefinedTransitionPolicy::Stop);
+	EXPECT_EQ(stopped.outputs, std::vector<std::string>({"x"}));
+	EXPECT_EQ(stopped.finalState, "S1");
+	EXPECT_EQ(stopped.consumed, 1);
+
+	const auto stayed = machine.Run(inputs, UndefinedTransitionPolicy::Stay);
+	EXPECT_EQ(stayed.outputs, std::vector<std::string>({"x", "y"}));
+	EXPECT_EQ(stayed.finalState, "S0");
+	EXPECT_EQ(stayed.consumed, 4);
+}
+
+TEST(SimulationTest, RunIntoStreamsOutputs)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S0", "x");
+
+	const MachineTable table(machine);
+	const std::vector<MachineTable::Id> inputs(10, table.FindInput("a"));
+
+	MachineTable::Id state = table.GetStartState();
+	size_t emitted = 0;
+	const size_t consumed = table.RunInto(inputs, state, [&](MachineTable::Id output) {
+		EXPECT_EQ(table.GetOutputName(output), "x");
+		++emitted;
+	});
+
+	EXPECT_EQ(consumed, 10);
+	EXPECT_EQ(emitted, 10);
+	EXPECT_EQ(table.GetStateName(state), "S0");
+}
+
+TEST(SimulationTest, RunIntoReportsSteps)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "b", "S0", "y");
+
+	const MachineTable table(machine);
+	const MachineTable::Id a = table.FindInput("a");
+	const MachineTable::Id b = table.FindInput("b");
+	const std::vector<MachineTable::Id> inputs = {a, a, b, MachineTable::NO_ID, a};
+
+	std::vector<std::tuple<MachineTable::Id, MachineTable::Id, size_t>> steps;
+	const auto onStep = [&](MachineTable::Id from, MachineTable::Id input, size_t cell) { steps.emplace_back(from, input, cell); };
+	const auto cellOf = [&](MachineTable::Id from, MachineTable::Id input) { return static_cast<size_t>(from) * table.GetInputCount() + input; };
+	const MachineTable::Id s0 = table.FindState("S0");
+	const MachineTable::Id s1 = table.FindState("S1");
+
+	MachineTable::Id state = table.GetStartState();
+	EXPECT_EQ(table.RunInto(inputs, state, [](MachineTable::Id) {}, onStep, UndefinedTransitionPolicy::Stay), inputs.size());
+	const std::vector<std::tuple<MachineTable::Id, MachineTable::Id, size_t>> expected = {
+		{s0, a, cellOf(s0, a)},
+		{s1, a, MachineTable::NO_CELL},
+		{s1, b, cellOf(s1, b)},
+		{s0, MachineTable::NO_ID, MachineTable::NO_CELL},
+		{s0, a, cellOf(s0, a)},
+	};
+	EXPECT_EQ(steps, expected);
+
+	steps.clear();
+	state = table.GetStartState();
+	EXPECT_THROW((void)table.RunInto(inputs, state, [](MachineTable::Id) {}, onStep), std::runtime_error);
+	EXPECT_EQ(steps.size(), 1);
+	EXPECT_EQ(state, s1);
+}
+
+TEST(SimulationTest, RunBatchMatchesSingleStreamRuns)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 20; ++state)
+	{
+		machine.SetTransition("S" + std::to_string(state), "a", "S" + std::to_string((state + 1) % 20), "o" + std::to_string(state % 3));
+		if (state % 4 != 3)
+		{
+			machine.SetTransition("S" + std::to_string(state), "b", "S" + std::to_string(state * 7 % 20), "o" + std::to_string(state % 5));
+		}
+	}
+
+	const MachineTable table(machine);
+	std::vector<std::vector<MachineTable::Id>> inputs(37);
+	for (size_t stream = 0; stream < inputs.size(); ++stream)
+	{
+		for (size_t i = 0; i < stream * 3; ++i)
+		{
+			inputs[stream].push_back((stream * 13 + i * i) % 3 == 0 ? table.FindInput("b") : table.FindInput("a"));
+		}
+	}
+	const std::vector<std::span<const MachineTable::Id>> streams(inputs.begin(), inputs.end());
+
+	for (const auto policy : {UndefinedTransitionPolicy::Stop, UndefinedTransitionPolicy::Stay})
+	{
+		const auto results = table.RunBatch(streams, policy);
+		ASSERT_EQ(results.size(), streams.size());
+		for (size_t stream = 0; stream < streams.size(); ++stream)
+		{
+			const auto expected = table.Run(streams[stream], policy);
+			EXPECT_EQ(results[stream].outputs, expected.outputs);
+			EXPECT_EQ(results[stream].finalState, expected.finalState);
+			EXPECT_EQ(results[stream].consumed, expected.consumed);
+		}
+	}
+}
+
+TEST(SimulationTest, StepInstancesMatchesSingleStreamRuns)
+{
+	MooreMachine machine;
+	for (int state = 0; state < 12; ++state)
+	{
+		machine.AddState("S" + std::to_string(state), "y" + std::to_string(state % 4));
+	}
+	machine.SetStartState("S0");
+	for (int state = 0; state < 12; ++state)
+	{
+		for (int input = 0; input < 3; ++input)
+		{
+			if ((state + input) % 5 != 4)
+			{
+				machine.SetTransition("S" + std::to_string(state), "x" + std::to_string(input), "S" + std::to_string((state * 5 + input * 7 + 1) % 12));
+			}
+		}
+	}
+
+	const MachineTable table(machine);
+	constexpr size_t instanceCount = 37;
+	constexpr size_t stepCount = 50;
+
+	std::vector<MachineTable::Id> states(instanceCount);
+	std::vector<MachineTable::Id> inputs(instanceCount * stepCount);
+	for (size_t instance = 0; instance < instanceCount; ++instance)
+	{
+		states[instance] = static_cast<MachineTable::Id>(instance % table.GetStateCount());
+		for (size_t step = 0; step < stepCount; ++step)
+		{
+			const size_t value = (instance * 31 + step * 17 + step * step) % 7;
+			inputs[step * instanceCount + instance] = value < 3 ? static_cast<MachineTable::Id>(value) : (value == 6 ? MachineTable::NO_ID : static_cast<MachineTable::Id>(value % 3));
+		}
+	}
+
+	const std::vector<MachineTable::Id> initialStates = states;
+	std::vector<MachineTable::Id> outputs(inputs.size());
+	table.StepInstances(states, inputs, outputs);
+
+	for (size_t instance = 0; instance < instanceCount; ++instance)
+	{
+		std::vector<MachineTable::Id> instanceInputs;
+		std::vector<MachineTable::Id> instanceOutputs;
+		for (size_t step = 0; step < stepCount; ++step)
+		{
+			instanceInputs.push_back(inputs[step * instanceCount + instance]);
+			if (outputs[step * instanceCount + instance] != MachineTable::NO_ID)
+			{
+				instanceOutputs.push_back(outputs[step * instanceCount + instance]);
+			}
+		}
+
+		std::vector<MachineTable::Id> expectedOutputs;
+		MachineTable::Id state = initialStates[instance];
+		table.RunInto(instanceInputs, state, [&](MachineTable::Id output) { expectedOutputs.push_back(output); }, UndefinedTransitionPolicy::Stay);
+
+		EXPECT_EQ(instanceOutputs, expectedOutputs);
+		EXPECT_EQ(states[instance], state);
+	}
+}
+
+TEST(SimulationTest, StepInstancesScalarPathMatchesLanes)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 9; ++state)
+	{
+		for (int input = 0; input < 4; ++input)
+		{
+			if ((state * 3 + input) % 7 != 6)
+			{
+				machine.SetTransition("S" + std::to_string(state), "x" + std::to_string(input), "S" + std::to_string((state * 4 + input + 2) % 9), "y" + std::to_string((state + input) % 5));
+			}
+		}
+	}
+
+	const MachineTable table(machine);
+	constexpr size_t instanceCount = 40;
+	constexpr size_t stepCount = 30;
+
+	std::vector<MachineTable::Id> states(instanceCount);
+	std::vector<MachineTable::Id> inputs(instanceCount * stepCount);
+	for (size_t instance = 0; instance < instanceCount; ++instance)
+	{
+		states[instance] = static_cast<MachineTable::Id>(instance % table.GetStateCount());
+		for (size_t step = 0; step < stepCount; ++step)
+		{
+			// Ids past the input count must come out as undefined transitions on both paths
+			inputs[step * instanceCount + instance] = static_cast<MachineTable::Id>((instance * 7 + step * 3) % 6);
+		}
+	}
+
+	std::vector<MachineTable::Id> scalarStates = states;
+	std::vector<MachineTable::Id> scalarOutputs(inputs.size());
+	std::vector<MachineTable::Id> stepInputs(stepCount);
+	std::vector<MachineTable::Id> stepOutputs(stepCount);
+	for (size_t instance = 0; instance < instanceCount; ++instance)
+	{
+		for (size_t step = 0; step < stepCount; ++step)
+		{
+			stepInputs[step] = inputs[step * instanceCount + instance];
+		}
+		// A single instance never fills a SIMD block, so this call always takes the scalar path
+		table.StepInstances(std::span(&scalarStates[instance], 1), stepInputs, stepOutputs);
+		for (size_t step = 0; step < stepCount; ++step)
+		{
+			scalarOutputs[step * instanceCount + instance] = stepOutputs[step];
+		}
+	}
+
+	std::vector<MachineTable::Id> outputs(inputs.size());
+	table.StepInstances(states, inputs, outputs);
+
+	EXPECT_EQ(states, scalarStates);
+	EXPECT_EQ(outputs, scalarOutputs);
+}
+
+TEST(SimulationTest, RunParallelMatchesSequentialRun)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 6; ++state)
+	{
+		machine.SetTransition("S" + std::to_string(state), "a", "S" + std::to_string((state + 1) % 6), "x" + std::to_string(state % 2));
+		machine.SetTransition("S" + std::to_string(state), "b", "S" + std::to_string(state / 2), "y");
+		if (state != 5)
+		{
+			machine.SetTransition("S" + std::to_string(state), "c", "S" + std::to_string(5 - state), "z");
+		}
+	}
+
+	const MachineTable table(machine);
+	std::vector<MachineTable::Id> inputs;
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		inputs.push_back(static_cast<MachineTable::Id>((i * i + i / 7) % 3));
+	}
+
+	for (const auto policy : {UndefinedTransitionPolicy::Stay, UndefinedTransitionPolicy::Stop})
+	{
+		const auto expected = table.Run(inputs, policy);
+		for (const size_t chunkCount : {2, 5, 16})
+		{
+			const auto result = table.RunParallel(inputs, policy, chunkCount);
+			EXPECT_EQ(result.outputs, expected.outputs);
+			EXPECT_EQ(result.finalState, expected.finalState);
+			EXPECT_EQ(result.consumed, expected.consumed);
+		}
+	}
+
+	EXPECT_THROW((void)table.RunParallel(inputs, UndefinedTransitionPolicy::Throw, 4), std::runtime_error);
+
+	std::vector<MachineTable::Id> definedInputs(inputs.size(), table.FindInput("a"));
+	definedInputs[4321] = table.FindInput("b");
+	const auto expected = table.Run(definedInputs);
+	const auto result = table.RunParallel(definedInputs, UndefinedTransitionPolicy::Throw, 7);
+	EXPECT_EQ(result.outputs, expected.outputs);
+	EXPECT_EQ(result.finalState, expected.finalState);
+
+	std::vector<MachineTable::Id> stoppingInputs(inputs.size(), table.FindInput("a"));
+	stoppingInputs[3005] = table.FindInput("c");
+	const auto stopped = table.RunParallel(stoppingInputs, UndefinedTransitionPolicy::Stop, 4);
+	EXPECT_EQ(stopped.consumed, 3005);
+	EXPECT_EQ(stopped.outputs.size(), 3005);
+	EXPECT_EQ(table.GetStateName(stopped.finalState), "S5");
+
+	// Sizes that do not divide evenly, including fewer inputs than chunks
+	for (const size_t size : {1, 2, 3, 5, 7, 9})
+	{
+		const std::span<const MachineTable::Id> shortInputs(definedInputs.data(), size);
+		const auto shortExpected = table.Run(shortInputs);
+		for (const size_t chunkCount : {2, 3, 4, 5, 8, 16})
+		{
+			const auto shortResult = table.RunParallel(shortInputs, UndefinedTransitionPolicy::Throw, chunkCount);
+			EXPECT_EQ(shortResult.consumed, size) << size << " " << chunkCount;
+			EXPECT_EQ(shortResult.outputs, shortExpected.outputs) << size << " " << chunkCount;
+			EXPECT_EQ(shortResult.finalState, shortExpected.finalState) << size << " " << chunkCount;
+		}
+	}
+}
+
+TEST(SimulationTest, StrideTableMatchesSingleStepRun)
+{
+	MealyMachine machine;
+	machine.AddState("S1");
+	machine.SetStartState("S1");
+	machine.SetTransition("S1", "1", "S2", "w1");
+	machine.SetTransition("S1", "2", "S3", "w2");
+	machine.SetTransition("S2", "1", "S3", "w1");
+	machine.SetTransition("S2", "2", "S1", "w2");
+	machine.SetTransition("S3", "1", "S1", "w2");
+	machine.SetTransition("S3", "2", "S2", "w1");
+	machine.SetTransition("S4", "1", "S4", "w1");
+
+	const MachineTable table(machine);
+	std::vector<MachineTable::Id> inputs;
+	for (size_t i = 0; i < 1003; ++i)
+	{
+		inputs.push_back(static_cast<MachineTable::Id>((i * 7 + i / 3) % 2));
+	}
+
+	for (const size_t budget : {size_t{0}, size_t{256}, StrideTable::DEFAULT_BUDGET_BYTES})
+	{
+		const StrideTable strideTable(table, budget);
+		const auto expected = table.Run(inputs);
+		const auto result = strideTable.Run(inputs);
+		EXPECT_EQ(result.outputs, expected.outputs);
+		EXPECT_EQ(result.finalState, expected.finalState);
+		EXPECT_EQ(result.consumed, expected.consumed);
+		EXPECT_LE(strideTable.GetSizeBytes(), std::max(budget, table.GetStateCount() * table.GetInputCount() * 3 * sizeof(MachineTable::Id)));
+	}
+
+	EXPECT_EQ(StrideTable(table).GetStride(), StrideTable::MAX_STRIDE);
+}
+
+TEST(SimulationTest, StrideTableHandlesUndefinedTransitions)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+	machine.SetTransition("S1", "b", "S1", "z");
+
+	const MachineTable table(machine);
+	const StrideTable strideTable(table);
+	ASSERT_GT(strideTable.GetStride(), 1);
+
+	const std::vector<std::string> names = {"a", "b", "b", "a", "b", "a", "a", "b", "a"};
+	const auto inputs = table.EncodeInputs(names);
+
+	for (const auto policy : {UndefinedTransitionPolicy::Stay, UndefinedTransitionPolicy::Stop})
+	{
+		const auto expected = table.Run(inputs, policy);
+		const auto result = strideTable.Run(inputs, policy);
+		EXPECT_EQ(result.outputs, expected.outputs);
+		EXPECT_EQ(result.finalState, expected.finalState);
+		EXPECT_EQ(result.consumed, expected.consumed);
+	}
+	EXPECT_THROW((void)strideTable.Run(inputs), std::runtime_error);
+}
+
+TEST(SimulationTest, StreamTransducerRunsMappedFile)
+{
+	MooreMachine machine;
+	machine.AddState("S0", "y0");
+	machine.AddState("S1", "y1");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "x1", "S1");
+	machine.SetTransition("S1", "x1", "S1");
+	machine.SetTransition("S1", "x2", "S0");
+
+	const auto path = std::filesystem::temp_directory_path() / "stream_transducer_input.txt";
+	std::vector<std::string> names;
+	{
+		std::ofstream file(path);
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			names.push_back(i % 3 == 0 ? "x2" : "x1");
+			file << names.back() << (i % 10 == 9 ? "\n" : " ");
+		}
+	}
+
+	const MachineTable table(machine);
+	const auto expected = table.Decode(table.Run(names, UndefinedTransitionPolicy::Stay));
+
+	std::ostringstream output;
+	const auto result = StreamTransducer(table, 128).RunFile(path.string(), output, UndefinedTransitionPolicy::Stay);
+	std::filesystem::remove(path);
+
+	std::ostringstream expectedOutput;
+	for (const auto& name : expected.outputs)
+	{
+		expectedOutput << name << "\n";
+	}
+
+	EXPECT_EQ(output.str(), expectedOutput.str());
+	EXPECT_EQ(result.consumed, names.size());
+	EXPECT_EQ(result.emitted, expected.outputs.size());
+	EXPECT_EQ(table.GetStateName(result.finalState), expected.finalState);
+}
+
+TEST(SimulationTest, StreamTransducerStopsOnUnknownInput)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S0", "x");
+
+	const MachineTable table(machine);
+	std::ostringstream output;
+	const auto result = StreamTransducer(table).Run("a a\n\ta  q a", output, UndefinedTransitionPolicy::Stop);
+
+	EXPECT_EQ(output.str(), "x\nx\nx\n");
+	EXPECT_EQ(result.consumed, 3);
+	EXPECT_THROW(StreamTransducer(table).Run("a q", output), std::runtime_error);
+	EXPECT_THROW(StreamTransducer(table).RunFile("missing_input_file.txt", output), std::runtime_error);
+}
+
+TEST(SimulationTest, OutputModesCompressRepeatedOutputs)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+	machine.SetTransition("S1", "b", "S1", "z");
+
+	const std::vector<std::string> inputs = {"a", "b", "b", "b", "a", "a", "b"};
+
+	const auto changes = machine.Run(inputs, UndefinedTransitionPolicy::Throw, OutputMode::OnChange);
+	EXPECT_EQ(changes.outputs, std::vector<std::string>({"x", "z", "y", "x", "z"}));
+	EXPECT_EQ(changes.positions, std::vector<size_t>({0, 1, 4, 5, 6}));
+	EXPECT_EQ(changes.finalState, "S1");
+
+	const auto runs = machine.Run(inputs, UndefinedTransitionPolicy::Throw, OutputMode::RunLength);
+	EXPECT_EQ(runs.outputs, std::vector<std::string>({"x", "z", "y", "x", "z"}));
+	EXPECT_EQ(runs.counts, std::vector<size_t>({1, 3, 1, 1, 1}));
+	EXPECT_EQ(runs.consumed, inputs.size());
+
+	MooreMachine moore;
+	moore.AddState("S0", "low");
+	moore.AddState("S1", "low");
+	moore.AddState("S2", "high");
+	moore.SetStartState("S0");
+	moore.SetTransition("S0", "t", "S1");
+	moore.SetTransition("S1", "t", "S2");
+	moore.SetTransition("S2", "t", "S2");
+	moore.SetTransition("S2", "r", "S0");
+
+	const MachineTable table(moore);
+	const auto ids = table.EncodeInputs(std::vector<std::string>{"t", "t", "t", "t", "r", "t"});
+	const auto every = table.Run(ids);
+	const auto encoded = table.Run(ids, UndefinedTransitionPolicy::Throw, OutputMode::RunLength);
+	ASSERT_EQ(encoded.outputs.size(), encoded.counts.size());
+
+	std::vector<MachineTable::Id> expanded;
+	for (size_t i = 0; i < encoded.outputs.size(); ++i)
+	{
+		expanded.insert(expanded.end(), encoded.counts[i], encoded.outputs[i]);
+	}
+	EXPECT_EQ(expanded, every.outputs);
+	EXPECT_EQ(table.Decode(encoded).counts, std::vector<size_t>({1, 3, 2}));
+
+	const std::vector<std::span<const MachineTable::Id>> streams(20, ids);
+	for (const auto& result : table.RunBatch(streams, UndefinedTransitionPolicy::Throw, OutputMode::RunLength))
+	{
+		EXPECT_EQ(result.outputs, encoded.outputs);
+		EXPECT_EQ(result.counts, encoded.counts);
+	}
+	for (const auto& result : table.RunBatch(streams, UndefinedTransitionPolicy::Throw, OutputMode::OnChange))
+	{
+		EXPECT_EQ(result.positions, std::vector<size_t>({0, 1, 4}));
+	}
+}
+
+TEST(SimulationTest, StreamTransducerWritesCompressedOutputs)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S0", "x");
+	machine.SetTransition("S0", "b", "S0", "y");
+
+	const MachineTable table(machine);
+	const std::string_view input = "a a a b b a q a";
+
+	std::ostringstream changes;
+	const auto result = StreamTransducer(table, 8).Run(input, changes, UndefinedTransitionPolicy::Stay, OutputMode::OnChange);
+	EXPECT_EQ(changes.str(), "0 x\n3 y\n5 x\n");
+	EXPECT_EQ(result.emitted, 7);
+
+	std::ostringstream runs;
+	(void)StreamTransducer(table, 8).Run(input, runs, UndefinedTransitionPolicy::Stay, OutputMode::RunLength);
+	EXPECT_EQ(runs.str(), "x 3\ny 2\nx 2\n");
+
+	// The outputs before an undefined input reach the stream even though the run throws
+	std::ostringstream partial;
+	EXPECT_THROW((void)StreamTransducer(table, 4).Run("a b a a q a", partial), std::runtime_error);
+	EXPECT_EQ(partial.str(), "x\ny\nx\nx\n");
+	std::ostringstream partialRuns;
+	EXPECT_THROW((void)StreamTransducer(table, 4).Run("a b a a q a", partialRuns, UndefinedTransitionPolicy::Throw, OutputMode::RunLength), std::runtime_error);
+	EXPECT_EQ(partialRuns.str(), "x 1\ny 1\nx 2\n");
+
+	std::ostringstream failed;
+	failed.setstate(std::ios::badbit);
+	EXPECT_THROW((void)StreamTransducer(table, 4).Run("a b", failed), std::runtime_error);
+	try
+	{
+		(void)StreamTransducer(table, 4).Run("a b q", failed);
+		FAIL();
+	}
+	catch (const std::runtime_error& error)
+	{
+		EXPECT_NE(std::string(error.what()).find("Undefined transition"), std::string::npos);
+	}
+}
+
+// Генерация кода
+
+template <typename StepFunc>
+void ExpectGeneratedMatchesTable(const MachineTable& table, uint32_t startState, StepFunc step)
+{
+	ASSERT_EQ(startState, table.GetStartState());
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<MachineTable::Id> inputDistribution(0, static_cast<MachineTable::Id>(table.GetInputCount()));
+
+	for (size_t run = 0; run < 100; ++run)
+	{
+		MachineTable::Id expectedState = table.GetStartState();
+		uint32_t state = startState;
+		for (size_t i = 0; i < 200; ++i)
+		{
+			const MachineTable::Id input = inputDistribution(random);
+			const auto cell = input < table.GetInputCount() ? table.GetCell(expectedState, input) : MachineTable::Cell{};
+
+			uint32_t output = 0;
+			ASSERT_EQ(step(state, input, output), cell.next != MachineTable::NO_ID);
+			if (cell.next != MachineTable::NO_ID)
+			{
+				expectedState = cell.next;
+				EXPECT_EQ(output, cell.output);
+			}
+			EXPECT_EQ(state, expectedState);
+		}
+	}
+}
+
+TEST(CodegenTest, GeneratedMealyMatchesInterpreter)
+{
+	const MachineTable table(MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot"));
+	ASSERT_EQ(GeneratedMealy::STATE_COUNT, table.GetStateCount());
+	ASSERT_EQ(GeneratedMealy::INPUT_COUNT, table.GetInputCount());
+	for (MachineTable::Id output = 0; output < table.GetOutputCount(); ++output)
+	{
+		EXPECT_EQ(GeneratedMealy::OUTPUT_NAMES[output], table.GetOutputName(output));
+	}
+
+	ExpectGeneratedMatchesTable(table, GeneratedMealy::START_STATE, GeneratedMealy::Step);
+}
+
+TEST(CodegenTest, GeneratedMooreMatchesInterpreter)
+{
+	const MachineTable table(MooreMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot"));
+	ASSERT_EQ(GeneratedMoore::STATE_COUNT, table.GetStateCount());
+	for (MachineTable::Id state = 0; state < table.GetStateCount(); ++state)
+	{
+		EXPECT_EQ(GeneratedMoore::STATE_NAMES[state], table.GetStateName(state));
+		EXPECT_EQ(GeneratedMoore::GetStateOutput(state), table.GetStateOutput(state));
+	}
+
+	ExpectGeneratedMatchesTable(table, GeneratedMoore::START_STATE, GeneratedMoore::Step);
+}
+
+TEST(CodegenTest, GeneratedStepIsConstexpr)
+{
+	constexpr auto stepFromStart = [] {
+		uint32_t state = GeneratedMealy::START_STATE;
+		uint32_t output = GeneratedMealy::NO_ID;
+		GeneratedMealy::Step(state, 0, output);
+		return state;
+	};
+	static_assert(stepFromStart() < GeneratedMealy::STATE_COUNT);
+}
+
+TEST(CodegenTest, ToCppSourceRejectsInvalidName)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetTransition("S0", "a", "S0", "x\"y");
+
+	EXPECT_THROW((void)machine.ToCppSource("1bad"), std::invalid_argument);
+	EXPECT_THROW((void)machine.ToCppSource("bad-name"), std::invalid_argument);
+	EXPECT_THROW((void)machine.ToCppSource("class"), std::invalid_argument);
+	EXPECT_THROW((void)machine.ToCppSource("co_yield"), std::invalid_argument);
+	EXPECT_THROW((void)machine.ToCppSource("_Reserved"), std::invalid_argument);
+	EXPECT_THROW((void)machine.ToCppSource("a__b"), std::invalid_argument);
+	EXPECT_NO_THROW((void)machine.ToCppSource("classes"));
+
+	const auto source = machine.ToCppSource("Escaped");
+	EXPECT_NE(source.find("namespace Escaped"), std::string::npos);
+	EXPECT_NE(source.find(R"("x\"y")"), std::string::npos);
+}
+
+TEST(CodegenTest, EmptyNameTablesHaveZeroLength)
+{
+	MooreMachine machine;
+	machine.AddState("S0", "y");
+	machine.SetStartState("S0");
+
+	const auto source = machine.ToCppSource("NoInputs");
+	EXPECT_NE(source.find("std::array<std::string_view, 0> INPUT_NAMES = {};"), std::string::npos);
+	EXPECT_NE(source.find("std::array<std::string_view, 1> STATE_NAMES = {\"S0\"};"), std::string::npos);
+	EXPECT_EQ(source.find("{\"\"}"), std::string::npos);
+}
+
+// Разбор DOT
+
+TEST(DotParsingTest, ScannerAcceptsRegexGrammar)
+{
+	const std::regex stateRegex(R"lit(^\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
+	const std::regex transitionRegex(R"lit(^\s*(\w+)\s*->\s*(\w+)\s*\[label\s*=\s*"([^"]*)"\]\s*$)lit");
+
+	const std::vector<std::string> lines = {
+		"S0 [label = \"S0\"]",
+		"  S_1\t[label=\"\"]  \r",
+		"S0 -> S1 [label = \"a/b\"]",
+		"S0->S1[label =\"a/b/c\"]\t",
+		"S0 -> S1 [ label = \"a/b\"]",
+		"S0 -> S1 [label = \"a/b\" ]",
+		"S0 -> [label = \"a\"]",
+		"S-0 [label = \"x\"]",
+		"S0 [label = \"x\"] ;",
+		"S0 [label = \"x]",
+		"digraph mealyMachine {",
+		"}",
+		"",
+	};
+
+	for (const auto& line : lines)
+	{
+		std::smatch match;
+		const DotLine dotLine = ScanDotLine(line);
+		if (std::regex_match(line, match, transitionRegex))
+		{
+			EXPECT_EQ(dotLine.kind, DotLine::Kind::Transition) << line;
+			EXPECT_EQ(dotLine.fromNode, match[1].str());
+			EXPECT_EQ(dotLine.toNode, match[2].str());
+			EXPECT_EQ(dotLine.label, match[3].str());
+		}
+		else if (std::regex_match(line, match, stateRegex))
+		{
+			EXPECT_EQ(dotLine.kind, DotLine::Kind::State) << line;
+			EXPECT_EQ(dotLine.fromNode, match[1].str());
+			EXPECT_EQ(dotLine.label, match[2].str());
+		}
+		else
+		{
+			EXPECT_EQ(dotLine.kind, DotLine::Kind::None) << line;
+		}
+	}
+}
+
+TEST(DotParsingTest, FromDotFileReportsErrorPosition)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "dot_parsing_test.dot").string();
+	const auto parseError = [&](const std::string& text, auto parse) {
+		std::ofstream(path, std::ios::binary) << text;
+		try
+		{
+			(void)parse(path);
+		}
+		catch (const std::exception& error)
+		{
+			return std::string(error.what());
+		}
+		return std::string();
+	};
+
+	std::ofstream(path, std::ios::binary) << "digraph m {\r\nB [label = \"B\"]\r\nA [label = \"A\"]\r\n\r\nA -> B [label = \"x/y\"]\r\nB->B[label=\"x/z\"]\r\n";
+	const auto mealy = MealyMachine::FromDotFile(path);
+	EXPECT_EQ(mealy.GetStartState(), "B");
+	EXPECT_EQ(mealy.GetTransitions().size(), 2);
+
+	const auto badLabel = parseError("digraph m {\nA [label = \"A\"]\n  A -> A [label = \"x\"]\n", MealyMachine::FromDotFile);
+	EXPECT_NE(badLabel.find("line 3, column 20"), std::string::npos) << badLabel;
+
+	const auto undeclared = parseError("A [label = \"A/o\"]\nA -> Q [label = \"x\"]\n", MooreMachine::FromDotFile);
+	EXPECT_NE(undeclared.find("Undeclared state Q at line 2, column 6"), std::string::npos) << undeclared;
+	EXPECT_THROW((void)MooreMachine::FromDotFile(path), std::out_of_range);
+
+	std::filesystem::remove(path);
+}
+
+TEST(DotParsingTest, TableLoaderMatchesMachineLoaders)
+{
+	const std::string mealyPath = FINITE_AUTOMATION_RES_DIR "/mealy.dot";
+	const std::string moorePath = FINITE_AUTOMATION_RES_DIR "/moore.dot";
+	EXPECT_EQ(MachineTable::FromDotFile(mealyPath, MachineKind::Mealy).GetFingerprint(), MachineTable(MealyMachine::FromDotFile(mealyPath)).GetFingerprint());
+	EXPECT_EQ(MachineTable::FromDotFile(moorePath, MachineKind::Moore).GetFingerprint(), MachineTable(MooreMachine::FromDotFile(moorePath)).GetFingerprint());
+
+	const auto path = (std::filesystem::temp_directory_path() / "dot_table_loader_test.dot").string();
+	std::ofstream(path, std::ios::binary) << "digraph m {\n"
+											 "q1 [label = \"B/x\"]\n"
+											 "q0 [label = \"A/y\"]\n"
+											 "q2 [label = \"C\"]\n"
+											 "q3 [label = \"B/z\"]\n"
+											 "q1 -> q0 [label = \"a/o1\"]\n"
+											 "q1 -> q2 [label = \"a/o2\"]\n"
+											 "q0 -> q3 [label = \"b/o3\"]\n"
+											 "q2 -> q1 [label = \"a/o3\"]\n"
+											 "}\n";
+	EXPECT_EQ(MachineTable::FromDotFile(path, MachineKind::Mealy).GetFingerprint(), MachineTable(MealyMachine::FromDotFile(path)).GetFingerprint());
+	const auto moore = MachineTable::FromDotFile(path, MachineKind::Moore);
+	EXPECT_EQ(moore.GetFingerprint(), MachineTable(MooreMachine::FromDotFile(path)).GetFingerprint());
+	EXPECT_EQ(moore.GetStateName(moore.GetStartState()), "B");
+	EXPECT_EQ(moore.GetOutputName(moore.GetStateOutput(moore.FindState("B"))), "z");
+
+	std::ofstream(path, std::ios::binary) << "A [label = \"A\"]\nA -> A [label = \"x\"]\n";
+	EXPECT_THROW((void)MachineTable::FromDotFile(path, MachineKind::Mealy), std::runtime_error);
+	std::filesystem::remove(path);
+	EXPECT_THROW((void)MachineTable::FromDotFile(path, MachineKind::Moore), std::runtime_error);
+}
+
+TEST(DotParsingTest, ChunkedTableLoaderMatchesSequentialLoader)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "dot_chunked_loader_test.dot").string();
+	std::mt19937 random(48);
+	std::ostringstream dot;
+	dot << "digraph m {\n";
+	// Nodes are redeclared and transitions overwritten, so the result depends on the order of lines across chunks
+	for (int line = 0; line < 2000; ++line)
+	{
+		const auto node = "n" + std::to_string(random() % 40);
+		if (line < 40 || random() % 5 == 0)
+		{
+			dot << (line < 40 ? "n" + std::to_string(line) : node) << " [label = \"S" << random() % 30 << "/o" << random() % 7 << "\"]\n";
+		}
+		else
+		{
+			dot << node << " -> n" << random() % 40 << " [label = \"i" << random() % 9 << "/o" << random() % 7 << "\"]\n";
+		}
+	}
+	dot << "}\n";
+	std::ofstream(path, std::ios::binary) << dot.str();
+
+	for (const auto kind : {MachineKind::Mealy, MachineKind::Moore})
+	{
+		const auto sequential = MachineTable::FromDotFile(path, kind);
+		for (const size_t chunkCount : {0, 2, 3, 7, 64, 100000})
+		{
+			const auto chunked = MachineTable::FromDotFile(path, kind, chunkCount);
+			EXPECT_EQ(chunked.GetFingerprint(), sequential.GetFingerprint()) << chunkCount;
+			EXPECT_EQ(chunked.GetStartState(), sequential.GetStartState()) << chunkCount;
+		}
+	}
+
+	const auto errorOf = [&](const std::string& text, size_t chunkCount) {
+		std::ofstream(path, std::ios::binary) << text;
+		try
+		{
+			(void)MachineTable::FromDotFile(path, MachineKind::Mealy, chunkCount);
+		}
+		catch (const std::exception& error)
+		{
+			return std::string(error.what());
+		}
+		return std::string();
+	};
+	const std::string undeclared = "A [label = \"A\"]\nA -> B [label = \"x/y\"]\nB [label = \"B\"]\nB -> A [label = \"x\"]\n";
+	const std::string badLabel = "A [label = \"A\"]\nA -> A [label = \"x/y\"]\nA -> A [label = \"x\"]\nA -> Q [label = \"x/y\"]\n";
+	for (const size_t chunkCount : {2, 4})
+	{
+		EXPECT_EQ(errorOf(undeclared, chunkCount), errorOf(undeclared, 1));
+		EXPECT_EQ(errorOf(badLabel, chunkCount), errorOf(badLabel, 1));
+	}
+	EXPECT_NE(errorOf(undeclared, 4).find("Undeclared state B at line 2"), std::string::npos);
+	EXPECT_NE(errorOf(badLabel, 4).find("line 3"), std::string::npos);
+	std::filesystem::remove(path);
+}
+
+TEST(DotParsingTest, WriteDotOrdersTransitionsByTarget)
+{
+	MealyMachine mealy;
+	mealy.AddState("S1");
+	mealy.SetStartState("S1");
+	mealy.SetTransition("S1", "a", "S2", "x");
+	mealy.SetTransition("S1", "b", "S0", "y");
+	mealy.SetTransition("S0", "b", "S1", "x");
+	mealy.SetTransition("S0", "a", "S1", "z");
+
+	std::ostringstream mealyDot;
+	mealy.WriteDot(mealyDot);
+	EXPECT_EQ(mealyDot.str(), mealy.ToDotString());
+	EXPECT_EQ(mealyDot.str(), "digraph mealyMachine {\n"
+							  "S0 [label = \"S0\"]\nS1 [label = \"S1\"]\nS2 [label = \"S2\"]\n\n"
+							  "S0 -> S1 [label = \"a/z\"]\nS0 -> S1 [label = \"b/x\"]\n"
+							  "S1 -> S0 [label = \"b/y\"]\nS1 -> S2 [label = \"a/x\"]\n\n");
+
+	const MooreMachine moore(mealy);
+	std::ostringstream mooreDot;
+	moore.WriteDot(mooreDot);
+	EXPECT_EQ(mooreDot.str(), moore.ToDotString());
+	EXPECT_TRUE(mooreDot.str().ends_with("]\n}\n"));
+
+	const auto path = (std::filesystem::temp_directory_path() / "write_dot_test.dot").string();
+	{
+		std::ofstream file(path, std::ios::binary);
+		moore.WriteDot(file);
+	}
+	EXPECT_EQ(MooreMachine::FromDotFile(path).GetTransitions(), moore.GetTransitions());
+	std::filesystem::remove(path);
+}
+
+// Статические автоматы
+
+constexpr auto STATIC_MEALY = MakeStaticMealyMachine([] {
+	return std::string_view{R"(digraph machine {
+S1 [label = "S1"]
+S2 [label = "S2"]
+S3 [label = "S3"]
+
+S1 -> S2 [label = "1/w1"]
+S1 -> S3 [label = "2/w2"]
+S2 -> S3 [label = "1/w1"]
+S2 -> S1 [label = "2/w2"]
+S3 -> S1 [label = "1/w2"]
+S3 -> S2 [label = "2/w1"]
+})"};
+});
+
+constexpr auto STATIC_MOORE = MakeStaticMooreMachine([] {
+	return std::pair{
+		std::array{
+			StaticMooreState{"S0", "y0"},
+			StaticMooreState{"S1", "y1"},
+			StaticMooreState{"S2", "y0"},
+		},
+		std::array{
+			StaticMooreTransition{"S0", "x1", "S1"},
+			StaticMooreTransition{"S0", "x2", "S2"},
+			StaticMooreTransition{"S1", "x1", "S1"},
+			StaticMooreTransition{"S1", "x2", "S2"},
+			StaticMooreTransition{"S2", "x1", "S0"},
+			StaticMooreTransition{"S2", "x2", "S2"},
+		},
+	};
+});
+
+static_assert(STATIC_MEALY.GetStateCount() == 3 && STATIC_MEALY.GetInputCount() == 2 && STATIC_MEALY.GetOutputCount() == 2);
+static_assert(STATIC_MEALY.GetStateName(STATIC_MEALY.GetStartState()) == "S1");
+static_assert(sizeof(decltype(STATIC_MOORE)::Id) == 1);
+
+template <typename StaticMachineType>
+void ExpectStaticMatchesTable(const StaticMachineType& machine, const MachineTable& table)
+{
+	ASSERT_EQ(machine.GetStateCount(), table.GetStateCount());
+	ASSERT_EQ(machine.GetInputCount(), table.GetInputCount());
+	ASSERT_EQ(machine.GetOutputCount(), table.GetOutputCount());
+	EXPECT_EQ(machine.GetStartState(), table.GetStartState());
+
+	for (MachineTable::Id state = 0; state < table.GetStateCount(); ++state)
+	{
+		EXPECT_EQ(machine.GetStateName(static_cast<typename StaticMachineType::Id>(state)), table.GetStateName(state));
+		for (MachineTable::Id input = 0; input < table.GetInputCount(); ++input)
+		{
+			const auto expected = table.GetCell(state, input);
+			const auto cell = machine.GetCell(static_cast<typename StaticMachineType::Id>(state), static_cast<typename StaticMachineType::Id>(input));
+			EXPECT_EQ(cell.next == StaticMachineType::NO_ID ? MachineTable::NO_ID : cell.next, expected.next);
+			EXPECT_EQ(cell.output == StaticMachineType::NO_ID ? MachineTable::NO_ID : cell.output, expected.output);
+		}
+	}
+}
+
+TEST(StaticMachineTest, DotDefinitionMatchesParsedMachine)
+{
+	ExpectStaticMatchesTable(STATIC_MEALY, MachineTable(MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot")));
+}
+
+TEST(StaticMachineTest, LiteralDefinitionMatchesParsedMachine)
+{
+	ExpectStaticMatchesTable(STATIC_MOORE, MachineTable(MooreMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot")));
+	static_assert(STATIC_MOORE.GetStateOutput(STATIC_MOORE.FindState("S1")) == STATIC_MOORE.FindOutput("y1"));
+}
+
+TEST(StaticMachineTest, LaterDefinitionsOverwriteEarlierOnes)
+{
+	constexpr auto mealy = MakeStaticMealyMachine([] {
+		return std::array{
+			StaticMealyTransition{"A", "a", "B", "unused"},
+			StaticMealyTransition{"B", "a", "A", "x"},
+			StaticMealyTransition{"A", "a", "C", "y"},
+		};
+	});
+	static_assert(mealy.GetStateCount() == 3 && mealy.GetOutputCount() == 2);
+	static_assert(mealy.GetStateName(mealy.GetStartState()) == "A");
+	static_assert(mealy.GetCell(mealy.FindState("A"), mealy.FindInput("a")).next == mealy.FindState("C"));
+
+	constexpr auto moore = MakeStaticMooreMachine([] {
+		return std::string_view{"S0 [label = \"A/y0\"]\nS1 [label = \"B\"]\nS0 [label = \"A/y1\"]\nS0 -> S1 [label = \"x\"]\nS1 -> S0 [label = \"x\"]\n"};
+	});
+	static_assert(moore.GetStateCount() == 2 && moore.GetOutputCount() == 2);
+	static_assert(moore.GetStateOutput(moore.FindState("A")) == moore.FindOutput("y1"));
+	static_assert(moore.GetStateOutput(moore.FindState("B")) == moore.FindOutput(""));
+}
+
+TEST(StaticMachineTest, RunIntoFollowsUndefinedTransitionPolicy)
+{
+	constexpr auto machine = MakeStaticMealyMachine([] {
+		return std::array{
+			StaticMealyTransition{"S0", "a", "S1", "x"},
+			StaticMealyTransition{"S1", "a", "S0", "y"},
+			StaticMealyTransition{"S1", "b", "S1", "z"},
+		};
+	});
+	using Id = decltype(machine)::Id;
+
+	const std::array<Id, 4> inputs = {machine.FindInput("a"), machine.FindInput("b"), machine.FindInput("a"), machine.FindInput("b")};
+	std::vector<std::string_view> outputs;
+	const auto sink = [&](Id output) { outputs.push_back(machine.GetOutputName(output)); };
+
+	Id state = machine.GetStartState();
+	EXPECT_EQ(machine.RunInto(inputs, state, sink, UndefinedTransitionPolicy::Stay), 4);
+	EXPECT_EQ(outputs, (std::vector<std::string_view>{"x", "z", "y"}));
+
+	state = machine.GetStartState();
+	EXPECT_EQ(machine.RunInto(inputs, state, sink, UndefinedTransitionPolicy::Stop), 3);
+	EXPECT_EQ(machine.GetStateName(state), "S0");
+
+	state = machine.GetStartState();
+	EXPECT_THROW(machine.RunInto(inputs, state, sink), std::runtime_error);
+}
+
+// Сопрограммы
+
+TEST(TransducerTest, MealyTransducerMatchesRun)
+{
+	const MachineTable table(MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot"));
+	const std::vector<std::string> names = {"1", "2", "2", "1", "1", "2", "1"};
+	const auto inputs = table.EncodeInputs(names);
+
+	std::vector<MachineTable::Id> outputs;
+	for (const auto output : TransduceMealy(table, inputs))
+	{
+		outputs.push_back(output);
+	}
+	EXPECT_EQ(outputs, table.Run(inputs).outputs);
+}
+
+TEST(TransducerTest, MooreTransducerYieldsStateOutputs)
+{
+	const MachineTable table(MooreMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot"));
+
+	std::vector<std::string_view> outputs;
+	for (const auto output : TransduceMoore(table, TokenizeInputs(table, "x1 x1\n x2 x1 q x2"), UndefinedTransitionPolicy::Stop))
+	{
+		outputs.push_back(table.GetOutputName(output));
+	}
+	EXPECT_EQ(outputs, (std::vector<std::string_view>{"y1", "y1", "y0", "y0"}));
+
+	outputs.clear();
+	for (const auto output : TransduceMoore(table, TokenizeInputs(table, "x1 q x2"), UndefinedTransitionPolicy::Stay))
+	{
+		outputs.push_back(table.GetOutputName(output));
+	}
+	EXPECT_EQ(outputs, (std::vector<std::string_view>{"y1", "y0"}));
+
+	const auto consume = [&](auto&& generator) {
+		for ([[maybe_unused]] const auto output : generator)
+		{
+		}
+	};
+	EXPECT_THROW(consume(TransduceMoore(table, TokenizeInputs(table, "x1 q"))), std::runtime_error);
+	EXPECT_THROW(consume(TransduceMoore(MachineTable(MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot")), std::vector<MachineTable::Id>{})), std::invalid_argument);
+}
+
+TEST(TransducerTest, MooreTransducerMatchesRun)
+{
+	const MachineTable table(MooreMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot"));
+	const std::vector<std::string> names = {"x1", "x1", "x2", "x1", "x2"};
+	const auto inputs = table.EncodeInputs(names);
+
+	std::vector<MachineTable::Id> outputs;
+	for (const auto output : TransduceMoore(table, inputs))
+	{
+		outputs.push_back(output);
+	}
+	EXPECT_EQ(outputs, table.Run(inputs).outputs);
+	EXPECT_EQ(outputs.size(), inputs.size());
+}
+
+TEST(TransducerTest, StagesChainWithoutBuffers)
+{
+	MealyMachine first;
+	first.AddState("A");
+	first.SetStartState("A");
+	first.SetTransition("A", "a", "B", "p");
+	first.SetTransition("B", "a", "A", "q");
+	first.SetTransition("B", "b", "B", "p");
+
+	MealyMachine second;
+	second.AddState("X");
+	second.SetStartState("X");
+	second.SetTransition("X", "p", "Y", "0");
+	second.SetTransition("Y", "p", "X", "1");
+	second.SetTransition("Y", "q", "Y", "2");
+	second.SetTransition("X", "q", "X", "3");
+
+	const MachineTable firstTable(first);
+	const MachineTable secondTable(second);
+	const auto mapping = MapOutputsToInputs(firstTable, secondTable);
+
+	const std::string text = "a b a a b b a";
+	auto pipeline = TransduceMealy(secondTable, TransduceMealy(firstTable, TokenizeInputs(firstTable, text)) | std::views::transform([&](MachineTable::Id output) { return mapping[output]; }));
+
+	std::vector<std::string_view> outputs;
+	for (const auto output : pipeline)
+	{
+		outputs.push_back(secondTable.GetOutputName(output));
+	}
+
+	std::istringstream tokens(text);
+	const std::vector<std::string> names{std::istream_iterator<std::string>(tokens), std::istream_iterator<std::string>()};
+	const auto intermediate = firstTable.Decode(firstTable.Run(names));
+	const auto expected = secondTable.Decode(secondTable.Run(intermediate.outputs));
+	EXPECT_EQ(outputs, (std::vector<std::string_view>(expected.outputs.begin(), expected.outputs.end())));
+}
+
+// Сессии
+
+TEST(SessionEngineTest, BatchesMatchSequentialApplication)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 8; ++state)
+	{
+		for (int input = 0; input < 3; ++input)
+		{
+			if ((state + input) % 7 != 6)
+			{
+				machine.SetTransition("S" + std::to_string(state), "x" + std::to_string(input), "S" + std::to_string((state * 3 + input) % 8), "y" + std::to_string((state + input) % 4));
+			}
+		}
+	}
+
+	const MachineTable table(machine);
+	SessionEngine engine(table, 500);
+	std::vector<MachineTable::Id> expectedStates(engine.GetSessionCount(), table.GetStartState());
+
+	std::mt19937 random(7);
+	for (const auto& [batchSize, order] : {std::pair{size_t{10}, SessionBatchOrder::ByState}, {size_t{5000}, SessionBatchOrder::Arrival}, {size_t{20000}, SessionBatchOrder::ByState}, {size_t{3}, SessionBatchOrder::Arrival}})
+	{
+		std::vector<SessionEngine::Event> events(batchSize);
+		for (auto& event : events)
+		{
+			event.session = static_cast<SessionEngine::SessionId>(random() % engine.GetSessionCount());
+			event.input = static_cast<MachineTable::Id>(random() % (table.GetInputCount() + 1));
+		}
+
+		std::vector<MachineTable::Id> expectedOutputs;
+		for (const auto& event : events)
+		{
+			auto& state = expectedStates[event.session];
+			const auto cell = event.input < table.GetInputCount() ? table.GetCell(state, event.input) : MachineTable::Cell{};
+			state = cell.next == MachineTable::NO_ID ? state : cell.next;
+			expectedOutputs.push_back(cell.output);
+		}
+
+		EXPECT_EQ(engine.Apply(events, order), expectedOutputs);
+		EXPECT_TRUE(std::ranges::equal(engine.GetStates(), expectedStates));
+	}
+}
+
+TEST(SessionEngineTest, ManagesSessions)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+
+	const MachineTable table(machine);
+	SessionEngine engine(table);
+	const auto first = engine.AddSession();
+	const auto second = engine.AddSession();
+	EXPECT_EQ(engine.GetSessionCount(), 2);
+
+	const std::vector<SessionEngine::Event> events = {{second, 0}, {second, 0}, {first, 0}};
+	EXPECT_EQ(engine.Apply(events), (std::vector<MachineTable::Id>{table.FindOutput("x"), table.FindOutput("y"), table.FindOutput("x")}));
+	EXPECT_EQ(table.GetStateName(engine.GetState(first)), "S1");
+
+	engine.ResetSession(first);
+	EXPECT_EQ(engine.GetState(first), table.GetStartState());
+	engine.SetState(second, table.FindState("S1"));
+	EXPECT_EQ(table.GetStateName(engine.GetState(second)), "S1");
+
+	const std::vector<SessionEngine::Event> unknown = {{first, 0}, {7, 0}};
+	EXPECT_THROW((void)engine.Apply(unknown), std::out_of_range);
+	EXPECT_EQ(engine.GetState(first), table.GetStartState());
+	EXPECT_THROW(engine.SetState(first, 5), std::out_of_range);
+	EXPECT_THROW(SessionEngine(MachineTable(MealyMachine()), 1), std::runtime_error);
+}
+
+TEST(SessionEngineTest, ShardedEngineKeepsPerSessionOrder)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 5; ++state)
+	{
+		for (int input = 0; input < 2; ++input)
+		{
+			machine.SetTransition("S" + std::to_string(state), "x" + std::to_string(input), "S" + std::to_string((state * 2 + input + 1) % 5), "y" + std::to_string(state * 2 + input));
+		}
+	}
+
+	const MachineTable table(machine);
+	constexpr size_t SESSION_COUNT = 97;
+	constexpr size_t PRODUCER_COUNT = 4;
+	constexpr size_t EVENTS_PER_PRODUCER = 20000;
+
+	std::vector<std::vector<SessionEngine::Event>> producerEvents(PRODUCER_COUNT);
+	std::mt19937 random(11);
+	for (size_t producer = 0; producer < PRODUCER_COUNT; ++producer)
+	{
+		for (size_t i = 0; i < EVENTS_PER_PRODUCER; ++i)
+		{
+			const auto session = static_cast<SessionEngine::SessionId>(producer + PRODUCER_COUNT * (random() % (SESSION_COUNT / PRODUCER_COUNT)));
+			producerEvents[producer].push_back({session, static_cast<MachineTable::Id>(random() % 2)});
+		}
+	}
+
+	ShardedSessionEngine engine(table, SESSION_COUNT, 3, 5, 64);
+	EXPECT_EQ(engine.GetShardCount(), 5);
+	{
+		std::vector<std::jthread> producers;
+		for (const auto& events : producerEvents)
+		{
+			producers.emplace_back([&engine, &events] {
+				for (size_t i = 0; i < events.size(); i += 100)
+				{
+					engine.Submit(std::span(events).subspan(i, std::min<size_t>(100, events.size() - i)));
+				}
+			});
+		}
+	}
+	engine.Flush();
+
+	SessionEngine expected(table, SESSION_COUNT);
+	std::vector<std::vector<MachineTable::Id>> expectedOutputs(SESSION_COUNT);
+	for (const auto& events : producerEvents)
+	{
+		const auto outputs = expected.Apply(events);
+		for (size_t i = 0; i < events.size(); ++i)
+		{
+			expectedOutputs[events[i].session].push_back(outputs[i]);
+		}
+	}
+
+	std::vector<std::vector<MachineTable::Id>> outputs(SESSION_COUNT);
+	for (const auto& emission : engine.TakeOutputs())
+	{
+		outputs[emission.session].push_back(emission.output);
+	}
+	EXPECT_EQ(outputs, expectedOutputs);
+	EXPECT_TRUE(engine.TakeOutputs().empty());
+
+	for (SessionEngine::SessionId session = 0; session < SESSION_COUNT; ++session)
+	{
+		EXPECT_EQ(engine.GetState(session), expected.GetState(session));
+	}
+	EXPECT_THROW(engine.Submit({SESSION_COUNT, 0}), std::out_of_range);
+}
+
+// Контрольные точки
+
+TEST(CheckpointTest, FullAndIncrementalCheckpointsRestoreSessions)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S2", "y");
+	machine.SetTransition("S2", "a", "S0", "z");
+	machine.SetTransition("S1", "b", "S1", "w");
+
+	const MachineTable table(machine);
+	const auto directory = std::filesystem::temp_directory_path();
+	const auto full = (directory / "session_checkpoint_full.bin").string();
+	const auto incremental = (directory / "session_checkpoint_incremental.bin").string();
+
+	SessionEngine engine(table, 1000);
+	std::vector<SessionEngine::Event> events;
+	for (SessionEngine::SessionId session = 0; session < 1000; session += 3)
+	{
+		events.push_back({session, 0});
+	}
+	(void)engine.Apply(events);
+	WriteCheckpoint(full, engine, CheckpointKind::Full);
+	EXPECT_TRUE(engine.GetChangedSessions().empty());
+
+	const std::vector<SessionEngine::Event> later = {{1, 0}, {3, 1}, {6, 0}, {6, 0}, {6, 0}};
+	(void)engine.Apply(later);
+	engine.AddSessions(2);
+	EXPECT_EQ(engine.GetChangedSessions(), (std::vector<SessionEngine::SessionId>{1, 6, 1000, 1001}));
+	WriteCheckpoint(incremental, engine, CheckpointKind::Incremental);
+	EXPECT_EQ(std::filesystem::file_size(incremental), std::filesystem::file_size(full) - 1000 * sizeof(MachineTable::Id) + 4 * 8);
+
+	SessionEngine restored(table);
+	RestoreCheckpoint(full, restored);
+	EXPECT_EQ(restored.GetSessionCount(), 1000);
+	RestoreCheckpoint(incremental, restored);
+	EXPECT_TRUE(std::ranges::equal(restored.GetStates(), engine.GetStates()));
+	EXPECT_TRUE(restored.GetChangedSessions().empty());
+	EXPECT_FALSE(std::filesystem::exists(incremental + ".tmp"));
+
+	std::filesystem::remove(full);
+	std::filesystem::remove(incremental);
+}
+
+TEST(CheckpointTest, IncrementalCheckpointsApplyInSequence)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+
+	const MachineTable table(machine);
+	const auto directory = std::filesystem::temp_directory_path();
+	const auto full = (directory / "sequence_checkpoint_full.bin").string();
+	const auto first = (directory / "sequence_checkpoint_first.bin").string();
+	const auto second = (directory / "sequence_checkpoint_second.bin").string();
+
+	SessionEngine engine(table, 8);
+	WriteCheckpoint(full, engine, CheckpointKind::Full);
+	(void)engine.Apply(std::vector<SessionEngine::Event>{{1, 0}});
+	WriteCheckpoint(first, engine, CheckpointKind::Incremental);
+	(void)engine.Apply(std::vector<SessionEngine::Event>{{1, 0}, {2, 0}});
+	WriteCheckpoint(second, engine, CheckpointKind::Incremental);
+	EXPECT_EQ(engine.GetCheckpointSequence(), 3);
+
+	SessionEngine skipped(table);
+	RestoreCheckpoint(full, skipped);
+	EXPECT_THROW(RestoreCheckpoint(second, skipped), std::runtime_error);
+
+	SessionEngine twice(table);
+	RestoreCheckpoint(full, twice);
+	RestoreCheckpoint(first, twice);
+	EXPECT_THROW(RestoreCheckpoint(first, twice), std::runtime_error);
+	RestoreCheckpoint(second, twice);
+	EXPECT_TRUE(std::ranges::equal(twice.GetStates(), engine.GetStates()));
+
+	// An incremental header claiming far more sessions than it has records for is rejected before sessions are added
+	{
+		std::fstream file(first, std::ios::binary | std::ios::in | std::ios::out);
+		const std::uint64_t sessionCount = std::uint64_t{1} << 40;
+		file.seekp(24);
+		file.write(reinterpret_cast<const char*>(&sessionCount), sizeof(sessionCount));
+	}
+	SessionEngine oversized(table);
+	RestoreCheckpoint(full, oversized);
+	EXPECT_THROW(RestoreCheckpoint(first, oversized), std::runtime_error);
+	EXPECT_EQ(oversized.GetSessionCount(), 8);
+
+	std::filesystem::remove(full);
+	std::filesystem::remove(first);
+	std::filesystem::remove(second);
+}
+
+TEST(CheckpointTest, RejectsMismatchedMachines)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+	const MachineTable table(machine);
+	EXPECT_EQ(MachineTable(machine).GetFingerprint(), table.GetFingerprint());
+
+	machine.SetTransition("S1", "a", "S1", "y");
+	const MachineTable changed(machine);
+	EXPECT_NE(table.GetFingerprint(), changed.GetFingerprint());
+
+	const auto path = (std::filesystem::temp_directory_path() / "run_checkpoint.bin").string();
+	const std::vector<MachineTable::Id> states = {1, 0, 1, 1};
+	WriteCheckpoint(path, table, states);
+	EXPECT_EQ(RestoreCheckpoint(path, table), states);
+	EXPECT_THROW((void)RestoreCheckpoint(path, changed), std::runtime_error);
+
+	SessionEngine engine(changed);
+	EXPECT_THROW(RestoreCheckpoint(path, engine), std::runtime_error);
+	EXPECT_EQ(engine.GetSessionCount(), 0);
+
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	EXPECT_THROW((void)RestoreCheckpoint(path, table), std::runtime_error);
+	std::filesystem::remove(path);
+}
+
+// Двоичный формат
+
+TEST(BinaryFormatTest, SavedTablesLoadUnchanged)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "machine_binary_test.fab").string();
+	const auto mealy = MachineTable::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot", MachineKind::Mealy);
+	const auto moore = MachineTable::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot", MachineKind::Moore);
+	std::vector<MachineTable::Id> order(moore.GetStateCount());
+	std::iota(order.rbegin(), order.rend(), MachineTable::Id{0});
+
+	for (const auto& table : {mealy, moore, moore.WithStateOrder(order), MachineTable()})
+	{
+		table.SaveBinary(path);
+		EXPECT_EQ(std::filesystem::file_size(path) % 8, 0);
+		const auto loaded = MachineTable::LoadBinary(path);
+		EXPECT_EQ(loaded.GetFingerprint(), table.GetFingerprint());
+		EXPECT_EQ(loaded.GetKind(), table.GetKind());
+		for (MachineTable::Id state = 0; state < table.GetStateCount(); ++state)
+		{
+			EXPECT_EQ(loaded.FindState(table.GetStateName(state)), state);
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+TEST(BinaryFormatTest, RejectsDamagedFiles)
+{
+	const auto path = (std::filesystem::temp_directory_path() / "machine_binary_damaged.fab").string();
+	const auto table = MachineTable::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot", MachineKind::Mealy);
+	table.SaveBinary(path);
+	const auto size = static_cast<std::streamoff>(std::filesystem::file_size(path));
+
+	const auto patch = [&](std::streamoff offset, char value) {
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offset);
+		file.put(value);
+	};
+
+	patch(size - 1, 'x');
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+	table.SaveBinary(path);
+	patch(0, 'X');
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+	table.SaveBinary(path);
+	// stateCount
+	patch(24, 100);
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+	// Header fields that stay in range: the start state and the reserved word
+	for (const std::streamoff offset : {16, 20})
+	{
+		table.SaveBinary(path);
+		patch(offset, 1);
+		EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error) << offset;
+	}
+
+	table.SaveBinary(path);
+	std::filesystem::resize_file(path, static_cast<std::uintmax_t>(size - 8));
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+	std::filesystem::resize_file(path, 10);
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+	std::filesystem::remove(path);
+	EXPECT_THROW((void)MachineTable::LoadBinary(path), std::runtime_error);
+}
+
+// Композиция
+
+TEST(CompositionTest, ComposedMachineMatchesCascade)
+{
+	const auto first = MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot");
+
+	MealyMachine second;
+	second.AddState("A");
+	second.SetStartState("A");
+	second.SetTransition("A", "w1", "B", "0");
+	second.SetTransition("A", "w2", "A", "1");
+	second.SetTransition("B", "w1", "A", "1");
+	second.SetTransition("B", "w2", "C", "0");
+	second.SetTransition("C", "w1", "C", "0");
+	second.SetTransition("C", "w2", "A", "0");
+	second.AddState("Unreachable");
+
+	for (const bool minimize : {false, true})
+	{
+		const auto composed = MealyMachine::Compose(first, second, minimize);
+		if (!minimize)
+		{
+			EXPECT_EQ(composed.GetStartState(), "S1_A");
+			EXPECT_LE(composed.GetStates().size(), first.GetStates().size() * 3);
+			for (const auto& state : composed.GetStates())
+			{
+				EXPECT_EQ(state.find("Unreachable"), std::string::npos);
+			}
+		}
+
+		std::mt19937 random(3);
+		for (size_t run = 0; run < 20; ++run)
+		{
+			std::vector<std::string> inputs;
+			for (size_t i = 0; i < 50; ++i)
+			{
+				inputs.push_back(random() % 2 == 0 ? "1" : "2");
+			}
+
+			const auto intermediate = first.Run(inputs);
+			const auto expected = second.Run(intermediate.outputs);
+			EXPECT_EQ(composed.Run(inputs).outputs, expected.outputs);
+		}
+	}
+}
+
+TEST(CompositionTest, UndefinedIntermediateTransitionIsDropped)
+{
+	MealyMachine first;
+	first.AddState("P");
+	first.SetStartState("P");
+	first.SetTransition("P", "a", "P", "x");
+	first.SetTransition("P", "b", "Q", "y");
+	first.SetTransition("Q", "a", "P", "x");
+
+	MealyMachine second;
+	second.AddState("R");
+	second.SetStartState("R");
+	second.SetTransition("R", "x", "R", "out");
+
+	const auto composed = MealyMachine::Compose(first, second);
+	EXPECT_EQ(composed.GetStates(), (std::set<std::string>{"P_R"}));
+	EXPECT_EQ(composed.GetTransitions().size(), 1);
+	EXPECT_EQ(composed.GetTransitions().at({"P_R", "a"}), std::make_pair(std::string("P_R"), std::string("out")));
+	EXPECT_TRUE(MealyMachine::Compose(first, MealyMachine()).GetStates().empty());
+}
+
+TEST(SimulationTest, LockstepRunnerMatchesSeparateRuns)
+{
+	MealyMachine parity;
+	parity.AddState("Even");
+	parity.SetStartState("Even");
+	parity.SetTransition("Even", "a", "Odd", "odd");
+	parity.SetTransition("Odd", "a", "Even", "even");
+	parity.SetTransition("Odd", "c", "Odd", "odd");
+
+	std::vector<MachineTable> tables;
+	tables.emplace_back(MealyMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/mealy.dot"));
+	tables.emplace_back(MooreMachine::FromDotFile(FINITE_AUTOMATION_RES_DIR "/moore.dot"));
+	tables.emplace_back(parity);
+
+	const LockstepRunner runner(tables);
+	EXPECT_EQ(runner.GetMachineCount(), 3);
+	EXPECT_EQ(runner.GetInputCount(), 6);
+	EXPECT_EQ(runner.GetInputName(runner.FindInput("x2")), "x2");
+
+	const std::vector<std::string> alphabet = {"1", "2", "x1", "x2", "a", "c", "unknown"};
+	std::vector<std::string> names;
+	std::mt19937 random(5);
+	for (size_t i = 0; i < 500; ++i)
+	{
+		names.push_back(alphabet[random() % alphabet.size()]);
+	}
+
+	const auto result = runner.Run(runner.EncodeInputs(names));
+	ASSERT_EQ(result.outputs.size(), names.size() * tables.size());
+
+	for (size_t machine = 0; machine < tables.size(); ++machine)
+	{
+		const auto& table = tables[machine];
+		MachineTable::Id state = table.GetStartState();
+		for (size_t step = 0; step < names.size(); ++step)
+		{
+			const MachineTable::Id input = table.FindInput(names[step]);
+			const auto cell = input == MachineTable::NO_ID ? MachineTable::Cell{} : table.GetCell(state, input);
+			state = cell.next == MachineTable::NO_ID ? state : cell.next;
+			ASSERT_EQ(result.outputs[step * tables.size() + machine], cell.output);
+		}
+		EXPECT_EQ(result.finalStates[machine], state);
+	}
+
+	const auto parityOutput = result.outputs[(names.size() - 1) * tables.size() + 2];
+	if (parityOutput != MachineTable::NO_ID)
+	{
+		EXPECT_EQ(runner.GetOutputName(2, parityOutput), tables[2].GetOutputName(parityOutput));
+	}
+}
+
+// Раскладка состояний
+
+TEST(StateLayoutTest, HotChainsGetNeighbouringIds)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	const std::vector<std::string> hotChain = {"S0", "S7", "S3", "S9", "S5"};
+	for (size_t i = 0; i < hotChain.size(); ++i)
+	{
+		machine.SetTransition(hotChain[i], "a", hotChain[(i + 1) % hotChain.size()], "x");
+	}
+	for (int state = 0; state < 10; ++state)
+	{
+		machine.SetTransition("S" + std::to_string(state), "b", "S" + std::to_string((state + 1) % 10), "y");
+	}
+
+	const MachineTable table(machine);
+	std::vector<MachineTable::Id> inputs;
+	for (int i = 0; i < 100; ++i)
+	{
+		inputs.insert(inputs.end(), 9, table.FindInput("a"));
+		inputs.push_back(table.FindInput("b"));
+	}
+
+	TransitionProfile profile(table);
+	MachineTable::Id state = table.GetStartState();
+	EXPECT_EQ(profile.RunInto(inputs, state, [](MachineTable::Id) {}, UndefinedTransitionPolicy::Stay), inputs.size());
+	EXPECT_GT(profile.GetHits(table.FindState("S0"), table.FindInput("a")), 0);
+
+	const auto order = ComputeHotStateOrder(table, profile.GetHits());
+	const auto renumbered = table.WithStateOrder(order);
+	std::vector<size_t> chainIds;
+	for (const auto& name : hotChain)
+	{
+		chainIds.push_back(renumbered.FindState(name));
+	}
+	std::ranges::sort(chainIds);
+	EXPECT_EQ(chainIds, std::vector<size_t>({0, 1, 2, 3, 4}));
+	for (size_t i = 0; i + 1 < hotChain.size(); ++i)
+	{
+		const auto from = renumbered.FindState(hotChain[i]);
+		const auto to = renumbered.FindState(hotChain[i + 1]);
+		EXPECT_EQ(renumbered.GetCell(from, renumbered.FindInput("a")).next, to);
+	}
+
+	const auto expected = table.Decode(table.Run(inputs, UndefinedTransitionPolicy::Stay));
+	const auto actual = renumbered.Decode(renumbered.Run(inputs, UndefinedTransitionPolicy::Stay));
+	EXPECT_EQ(actual.outputs, expected.outputs);
+	EXPECT_EQ(actual.finalState, expected.finalState);
+	EXPECT_NE(renumbered.GetFingerprint(), table.GetFingerprint());
+
+	std::stringstream saved;
+	WriteStateOrder(table, order, saved);
+	EXPECT_EQ(ReadStateOrder(table, saved), order);
+
+	std::istringstream stale("S9\nGone\nS9\nS1\n");
+	const auto restored = ReadStateOrder(table, stale);
+	ASSERT_EQ(restored.size(), table.GetStateCount());
+	EXPECT_EQ(table.GetStateName(restored[0]), "S9");
+	EXPECT_EQ(table.GetStateName(restored[1]), "S1");
+	EXPECT_EQ(table.GetStateName(restored[2]), "S0");
+
+	EXPECT_THROW((void)table.WithStateOrder(std::vector<MachineTable::Id>(table.GetStateCount(), 0)), std::invalid_argument);
+}
+
+// Трассировка
+
+TEST(TraceRecorderTest, ReplayReconstructsRetainedSteps)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	for (int state = 0; state < 5; ++state)
+	{
+		const auto name = "S" + std::to_string(state);
+		machine.SetTransition(name, "a", "S" + std::to_string((state + 1) % 5), "x" + std::to_string(state));
+		machine.SetTransition(name, "b", "S" + std::to_string((state + 3) % 5), "y" + std::to_string(state % 2));
+		machine.SetTransition(name, "c", name, "z");
+	}
+
+	const MachineTable table(machine);
+	std::mt19937 random(7);
+	std::vector<MachineTable::Id> inputs(1000);
+	for (auto& input : inputs)
+	{
+		input = static_cast<MachineTable::Id>(random() % 4);
+	}
+	inputs[500] = MachineTable::NO_ID;
+
+	TraceRecorder recorder(table, 100);
+	EXPECT_EQ(recorder.GetCapacity(), 128);
+	EXPECT_EQ(recorder.GetBitsPerStep(), 5);
+
+	MachineTable::Id state = table.GetStartState();
+	std::vector<MachineTable::Id> outputs;
+	const auto consumed = recorder.RunInto(inputs, state, [&](MachineTable::Id output) { outputs.push_back(output); }, UndefinedTransitionPolicy::Stay);
+	EXPECT_EQ(consumed, inputs.size());
+	EXPECT_EQ(recorder.GetRecordedCount(), inputs.size());
+	EXPECT_EQ(recorder.GetSize(), 128);
+
+	std::vector<MachineTable::Id> states;
+	MachineTable::Id replayed = table.GetStartState();
+	for (const auto input : inputs)
+	{
+		states.push_back(replayed);
+		if (input < table.GetInputCount() && table.GetCell(replayed, input).next != MachineTable::NO_ID)
+		{
+			replayed = table.GetCell(replayed, input).next;
+		}
+	}
+
+	const auto steps = recorder.Decode();
+	ASSERT_EQ(steps.size(), 128);
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		const size_t step = inputs.size() - steps.size() + i;
+		EXPECT_EQ(steps[i].state, states[step]);
+		EXPECT_EQ(steps[i].input, inputs[step] < table.GetInputCount() ? inputs[step] : MachineTable::NO_ID);
+	}
+	EXPECT_EQ(steps.back().next, state);
+
+	TraceRecorder small(table, 1);
+	state = table.GetStartState();
+	const std::vector<MachineTable::Id> tail = {table.FindInput("a"), MachineTable::NO_ID, table.FindInput("b")};
+	(void)small.RunInto(tail, state, [](MachineTable::Id) {}, UndefinedTransitionPolicy::Stay);
+	std::ostringstream replay;
+	small.WriteReplay(replay);
+	EXPECT_EQ(replay.str(), "S0 a -> S1 / x0\nS1 ? -> S1 / ?\nS1 b -> S4 / y1\n");
+
+	small.Clear();
+	state = table.GetStartState();
+	EXPECT_THROW((void)small.RunInto(tail, state, [](MachineTable::Id) {}), std::runtime_error);
+	EXPECT_EQ(small.GetSize(), 1);
+	EXPECT_THROW(TraceRecorder(table, 0), std::invalid_argument);
+}
+
+// Покрытие
+
+TEST(CoverageTest, PerThreadCountersMergeIntoProfile)
+{
+	MealyMachine machine;
+	machine.AddState("S0");
+	machine.SetStartState("S0");
+	machine.SetTransition("S0", "a", "S1", "x");
+	machine.SetTransition("S1", "a", "S0", "y");
+	machine.SetTransition("S1", "b", "S1", "z");
+	machine.SetTransition("S0", "c", "S0", "w");
+
+	const MachineTable table(machine);
+	std::vector<MachineTable::Id> inputs;
+	for (int i = 0; i < 1000; ++i)
+	{
+		inputs.push_back(table.FindInput(i % 3 == 0 ? "b" : "a"));
+	}
+
+	TransitionProfile profile(table);
+	MachineTable::Id state = table.GetStartState();
+	(void)profile.RunInto(inputs, state, [](MachineTable::Id) {}, UndefinedTransitionPolicy::Stay);
+	std::vector<std::uint64_t> expected(profile.GetHits().begin(), profile.GetHits().end());
+	for (auto& hits : expected)
+	{
+		hits *= 4;
+	}
+
+	CoverageCounters counters(table, 4);
+	std::vector<std::thread> threads;
+	for (size_t thread = 0; thread < counters.GetThreadCount(); ++thread)
+	{
+		threads.emplace_back([&, thread] {
+			MachineTable::Id threadState = table.GetStartState();
+			(void)counters.RunInto(thread, inputs, threadState, [](MachineTable::Id) {}, UndefinedTransitionPolicy::Stay);
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	EXPECT_EQ(counters.Merge(), expected);
+	EXPECT_THROW((void)counters.RunInto(4, inputs, state, [](MachineTable::Id) {}), std::out_of_range);
+
+	CoverageCounters sampled(table, 1, 10);
+	state = table.GetStartState();
+	(void)sampled.RunInto(0, inputs, state, [](MachineTable::Id) {}, UndefinedTransitionPolicy::Stay);
+	const auto sampledHits = sampled.Merge();
+	std::uint64_t total = 0;
+	for (const auto hits : sampledHits)
+	{
+		EXPECT_EQ(hits % 10, 0);
+		total += hits;
+	}
+	EXPECT_EQ(total, std::accumulate(expected.begin(), expected.end(), std::uint64_t{0}) / 4 / 10 * 10);
+
+	const auto dot = ToCoverageDotString(machine, counters.Merge());
+	EXPECT_NE(dot.find("S0 -> S1 [label = \"a/x\\n" + std::to_string(expected[table.FindInput("a")]) + "\"]"), std::string::npos);
+	EXPECT_NE(dot.find("S0 -> S0 [label = \"c/w\\n0\", style = dashed]"), std::string::npos);
+	EXPECT_NE(dot.find("S1 [label = \"S1\"]"), std::string::npos);
+}